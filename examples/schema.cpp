@@ -0,0 +1,40 @@
+
+/*
+    Copyright (c) 2020-2024 Kristjan Kongas
+
+    Permission to use, copy, modify, and/or distribute this software for any
+    purpose with or without fee is hereby granted.
+
+    THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES WITH
+    REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY
+    AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY SPECIAL, DIRECT,
+    INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM
+    LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR
+    OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+    PERFORMANCE OF THIS SOFTWARE.
+*/
+
+#include <iostream>
+#include "fire-hpp/fire.hpp"
+
+using namespace std;
+
+struct options {
+    int x = 0;
+    int y = 0;
+    fire::optional<int> mul;
+};
+
+int main(int argc, const char **argv) {
+    fire::schema<options> schema("Adds two numbers, declared as a struct");
+    schema.add(&options::x, fire::arg("-x").bounds(-1000, 1000))
+          .add(&options::y, fire::arg("-y").bounds(-1000, 1000))
+          .add(&options::mul, fire::arg("--mul").one_of({-1, 0, 1}));
+
+    options opts = schema.parse(argc, argv);
+    if(opts.mul.has_value())
+        cout << opts.mul.value() << " * (" << opts.x << " + " << opts.y << ") = " << opts.mul.value() * (opts.x + opts.y) << endl;
+    else
+        cout << opts.x << " + " << opts.y << " = " << opts.x + opts.y << endl;
+    return 0;
+}
@@ -36,11 +36,12 @@
 
 #include <string>
 #include <iostream>
+#include <fstream>
 #include <sstream>
 #include <vector>
+#include <deque>
 #include <map>
 #include <unordered_map>
-#include <unordered_set>
 #include <cassert>
 #include <cstdlib>
 #include <cstddef>
@@ -49,11 +50,23 @@
 #include <limits>
 #include <cstring>
 #include <memory>
+#include <functional>
+#include <locale>
+#include <exception>
+#include <mutex>
 
 #if defined(__EXCEPTIONS) || defined(_CPPUNWIND)
 #define FIRE_EXCEPTIONS_ENABLED_
 #endif
 
+#if defined(__unix__) || defined(__APPLE__)
+#define FIRE_MMAP_ENABLED_
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 namespace fire {
     constexpr int _failure_code = 1;
 
@@ -62,14 +75,95 @@ namespace fire {
     template<typename R, typename ... Types>
     constexpr size_t _get_argument_count(R(*)(Types ...)) { return sizeof...(Types); }
 
+    // Tear-down version of C++17 std::string_view, doesn't own the characters it points to
+    class _string_view {
+        const char *_data = "";
+        size_t _size = 0;
+
+    public:
+        _string_view() = default;
+        _string_view(const char *data, size_t size): _data(data), _size(size) {}
+        _string_view(const char *data): _data(data), _size(strlen(data)) {}
+        _string_view(const std::string &s): _data(s.data()), _size(s.size()) {}
+
+        const char * data() const { return _data; }
+        size_t size() const { return _size; }
+        bool empty() const { return _size == 0; }
+        const char * begin() const { return _data; }
+        const char * end() const { return _data + _size; }
+        char operator[](size_t i) const { return _data[i]; }
+
+        inline _string_view substr(size_t pos, size_t count = std::string::npos) const;
+        inline size_t find(char c, size_t pos = 0) const;
+        inline bool operator==(const _string_view &other) const;
+        inline bool operator!=(const _string_view &other) const { return ! (*this == other); }
+        std::string str() const { return std::string(_data, _size); }
+    };
+
+    struct _string_view_hash {
+        inline size_t operator()(_string_view s) const;
+    };
+
     inline int _count_hyphens(const std::string &s);
     inline std::string _without_hyphens(const std::string &s);
     inline std::string _replace_all(const std::string &data, const std::string &from, const std::string &to);
 
-    inline void _instant_assert(bool pass, const std::string &msg, bool programmer_side);
-    inline void _api_assert(bool pass, const std::string &msg); // Programmer side assert
+    // Splits text into words like a POSIX shell handles quotes, backslashes and comments (no expansions), passing them
+    // to out.begin_word(), out.push(c) and out.end_word(). Returns false on an unterminated quote
+    template <typename OUT>
+    inline bool _split_shell_words(_string_view text, OUT &out);
+    // Splits a line into words[0, count), words beyond count are kept for reuse
+    inline bool _split_shell_words(_string_view line, std::vector<std::string> &words, size_t &count);
+
+    // Locale-independent conversion of a whole string straight into the destination type, similar to C++17 std::from_chars
+    enum class _parse_result { ok, invalid, out_of_range };
+    template <typename T, typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
+    inline _parse_result _from_chars(_string_view s, T &value);
+    template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
+    inline _parse_result _from_chars(_string_view s, T &value);
+
+    // Largest k for which 10^k is exactly representable with the given number of significand bits (5^k must fit)
+    constexpr int _max_exact_pow10(int digits, unsigned long long pow5 = 5, int k = 0) {
+        return k < 27 && (pow5 >> (digits < 63 ? digits : 63)) == 0 ? _max_exact_pow10(digits, pow5 * 5, k + 1) : k;
+    }
+
+    // Mathematically correct comparisons of values with different types, similar to C++20 std::cmp_less/std::cmp_equal
+    template <typename A, typename B>
+    using _mixed_sign = std::integral_constant<bool, std::is_integral<A>::value && std::is_integral<B>::value && std::is_signed<A>::value != std::is_signed<B>::value>;
+    template <typename A, typename B, typename std::enable_if<! _mixed_sign<A, B>::value>::type* = nullptr>
+    inline bool _less(const A &a, const B &b) { return a < b; }
+    template <typename A, typename B, typename std::enable_if<_mixed_sign<A, B>::value && std::is_signed<A>::value>::type* = nullptr>
+    inline bool _less(A a, B b) { return a < 0 || (typename std::make_unsigned<A>::type) a < b; }
+    template <typename A, typename B, typename std::enable_if<_mixed_sign<A, B>::value && std::is_signed<B>::value>::type* = nullptr>
+    inline bool _less(A a, B b) { return b >= 0 && a < (typename std::make_unsigned<B>::type) b; }
+    template <typename A, typename B> inline bool _equal(const A &a, const B &b) { return ! _less(a, b) && ! _less(b, a); }
+    inline bool _equal(const std::string &a, const std::string &b) { return a == b; }
+
+    // Binary search in a vector sorted by _less
+    template <typename T, typename V>
+    inline bool _sorted_contains(const std::vector<T> &sorted, const V &val) {
+        auto it = std::lower_bound(sorted.begin(), sorted.end(), val, [](const T &a, const V &b) { return _less(a, b); });
+        return it != sorted.end() && _equal(*it, val);
+    }
+
+    template <typename T>
+    inline std::vector<T> _sorted(std::vector<T> values) {
+        values.erase(std::remove_if(values.begin(), values.end(), [](const T &v) { return ! _equal(v, v); }), values.end()); // NaN never matches
+        std::sort(values.begin(), values.end());
+        return values;
+    }
+
+    inline void _instant_assert(bool pass, _string_view msg, bool programmer_side);
+    inline void _api_assert(bool pass, _string_view msg); // Programmer side assert
     inline void input_assert(bool pass, const std::string &msg); // CLI user side assert, can be called in fired_main
     inline void input_error(const std::string &msg); // equivalent to input_assert with pass==false
+    inline void free_parser_memory(); // Release parser state once fired_main runs, print_help() and helpful_name() won't know the arguments afterwards
+
+    // Assert variants taking a message builder (a callable returning the message), which only runs if the assertion fails
+    template <typename F, typename std::enable_if<! std::is_convertible<F, _string_view>::value>::type* = nullptr>
+    inline void _api_assert(bool pass, const F &msg_builder) { if(! pass) _api_assert(false, msg_builder()); }
+    template <typename F, typename std::enable_if<! std::is_convertible<F, std::string>::value>::type* = nullptr>
+    inline void input_assert(bool pass, const F &msg_builder) { if(! pass) input_assert(false, msg_builder()); }
 
     template<typename ORDER, typename VALUE>
     class _smallest {
@@ -80,6 +174,7 @@ namespace fire {
     public:
         void set(const ORDER &order, const VALUE &value);
         const VALUE & get() const;
+        const ORDER & get_order() const { return _order; }
         bool empty() const { return _empty; }
     };
 
@@ -93,11 +188,15 @@ namespace fire {
         optional() = default;
         optional(T value): _value(std::move(value)), _exists(true) {}
         optional<T>& operator=(const T& value) { _value = value; _exists = true; return *this; }
+        optional<T>& operator=(T&& value) { _value = std::move(value); _exists = true; return *this; }
+        template <typename ... Args>
+        T& emplace(Args&& ... args) { _value = T(std::forward<Args>(args)...); _exists = true; return _value; }
         bool operator==(const optional<T>& other) const { return _exists == other._exists && _value == other._value; }
         explicit operator bool() const { return _exists; }
         bool has_value() const { return _exists; }
-        T value_or(const T& def) const { return _exists ? _value : def; }
-        T value() const { _api_assert(_exists, "accessing unassigned optional"); return _value; }
+        T value_or(const T& def) const & { return _exists ? _value : def; }
+        T value_or(T def) && { return _exists ? std::move(_value) : std::move(def); }
+        const T& value() const { _api_assert(_exists, "accessing unassigned optional"); return _value; }
     };
 
     ///// fire-hpp's mechanics /////
@@ -106,18 +205,45 @@ namespace fire {
     struct _escape_exception {
     };
 
+    // A command line error, incorrect use of the API or a --help request. Passed to context::reporter and thrown
+    // under error_policy::exception
+    struct error: std::exception {
+        enum class kind { help, input, programmer };
+
+        kind k = kind::input;
+        int code = _failure_code; // Exit code used by error_policy::exit, 0 for help
+        std::string argument; // Argument the error is about (eg. --count or <0>), empty if it's not about a single one
+        std::string message; // Without the "Error: " prefix. Help text for kind::help
+
+        error() = default;
+        error(kind k, int code, std::string argument, std::string message):
+            k(k), code(code), argument(std::move(argument)), message(std::move(message)) {}
+        const char * what() const noexcept override { return message.c_str(); }
+    };
+
+    // What happens after an error is reported:
+    // exit - exit the process with error::code (default)
+    // status - leave the fire::program call, which returns error::code (run) or false (parse). Exits elsewhere
+    // exception - throw fire::error without reporting it. Same as status if exceptions are disabled
+    enum class error_policy { exit, status, exception };
+
     // Get argc and argv from main() function
     class c_args {
         int _argc = 0;
         char ** _argv = nullptr;
+        bool _owned = false; // Views of main()'s argv don't own the strings, copies do
 
     public:
         inline c_args() = default;
         inline c_args(const std::string &executable, const std::vector<std::string> &args);
         inline c_args& operator=(const c_args &other);
         inline c_args(const c_args &_other) { *this = _other; }
+        inline c_args& operator=(c_args &&other) noexcept;
+        inline c_args(c_args &&other) noexcept { *this = std::move(other); }
         inline ~c_args();
 
+        inline void view(int argc, const char **argv);
+
         inline int &argc() { return _argc; }
         inline char ** argv() { return _argv; }
 
@@ -125,33 +251,163 @@ namespace fire {
         inline void delete_storage();
     };
 
-    static c_args raw_args;
+    // Command line token as classified by _matcher::parse. Spans point into argv, so nothing is copied during parsing
+    struct _token {
+        enum class kind { positional, flag, named };
+
+        kind k;
+        int hyphens; // Named tokens only
+        _string_view name; // Named tokens only, without hyphens
+        _string_view value; // Argument value or positional argument itself, always ends at the end of an argv string
+
+        std::string name_with_hyphens() const { return std::string((size_t) hyphens, '-') + name.str(); }
+    };
+
+    // Raw argv string measured once before classification: its length, leading hyphens and whether it's a negative number
+    struct _arg_shape {
+        _string_view s;
+        int hyphens = 0;
+        bool negative_number = false; // Eg. `-5`, which is positional rather than a short name
+
+        inline explicit _arg_shape(const char *arg);
+        inline size_t eq() const { return s.find('=', (size_t) hyphens); }
+    };
+
+    // Contents of an @file, memory-mapped where possible. Its words are unquoted and '\0'-terminated in place
+    class _response_file {
+        char *_data = nullptr;
+        size_t _size = 0;
+        bool _mapped = false;
+
+    public:
+        _response_file() = default;
+        _response_file(const _response_file &) = delete;
+        _response_file& operator=(const _response_file &) = delete;
+        inline ~_response_file();
+
+        inline bool load(const char *path);
+        char * data() { return _data; }
+        size_t size() const { return _size; }
+    };
+
+    class _option_table;
+
+    // Command line with @file arguments replaced by the words of the files, which point into the files' contents.
+    // Values of declared options (`-s @value`) are never expanded
+    class _response_files {
+        std::vector<std::unique_ptr<_response_file>> _files;
+        std::deque<std::string> _copies; // Words ending at the very end of a file, which leaves no room for their '\0'
+        std::vector<const char *> _argv;
+        const _option_table *_options = nullptr;
+        bool _positional_only = false; // After `--`, which turns off expansion
+        bool _value_next = false; // The previous argument is an option taking the next one as its value
+
+        inline std::string add(const char *arg, int depth);
+
+    public:
+        static constexpr int max_depth = 8; // Nesting limit of response files, which also stops cycles
+
+        inline static bool is_file(const char *arg) { return arg[0] == '@' && arg[1] != '\0'; }
+        inline std::string expand(int argc, const char **argv, const _option_table &options); // Returns an error message, empty on success
+        int argc() const { return (int) _argv.size() - 1; }
+        const char ** argv() { return _argv.data(); }
+    };
+
+    // Interned argument names, each distinct name is stored once and referred to by a small integer id. Id 0 is the empty string
+    class _name_table {
+        std::deque<std::string> _names; // Elements never move, so the views in _ids stay valid
+        std::unordered_map<_string_view, int, _string_view_hash> _ids;
+
+    public:
+        inline _name_table() { intern(""); }
+        _name_table(const _name_table &) = delete;
+        _name_table& operator=(const _name_table &) = delete;
+        _name_table(_name_table &&) = default; // Moving a deque keeps its elements in place, so the views stay valid
+        _name_table& operator=(_name_table &&) = default;
+
+        inline int intern(_string_view name);
+        inline int find(_string_view name) const; // -1 if the name hasn't been interned
+        inline const std::string& get(int id) const { return _names[(size_t) id]; }
+        inline size_t size() const { return _names.size(); }
+    };
+
+    // Id of a name in the process-wide table, which only grows. Identifiers are built with the ids of their names,
+    // so that comparing names and tracking queries compare integers from any context or thread
+    inline int _intern_name(_string_view name);
+
+    struct variadic {
+    };
+
+    // A single entry of fire::arg's identifier (shorthand, long name, <positional name>, description, index or variadic).
+    // Entries are classified once on construction from their first characters and length, invalid kinds are reported by identifier
+    struct _identifier_entry {
+        enum class kind { description, shorthand, long_name, positional_name, index, variadic, // Valid kinds
+                          too_many_hyphens, shorthand_not_one_character, shorthand_starts_with_number, long_name_too_short };
+
+        const char *data = "";
+        size_t size = 0;
+        int index = 0;
+        kind k = kind::description;
+
+        constexpr _identifier_entry(const char *data, size_t size): data(data), size(size), k(classify(data, size)) {}
+        constexpr _identifier_entry(int index): index(index), k(kind::index) {}
+        constexpr _identifier_entry(variadic): k(kind::variadic) {}
+
+        template <typename T, typename std::enable_if<std::is_same<T, const char *>::value || std::is_same<T, char *>::value>::type* = nullptr>
+        _identifier_entry(T data): _identifier_entry(data, strlen(data)) {}
+
+        static constexpr kind classify(const char *s, size_t n) {
+            return n >= 2 && s[0] == '<' && s[n - 1] == '>' ? kind::positional_name :
+                   n == 0 || s[0] != '-' ? kind::description :
+                   n == 1 || s[1] != '-' ? (n != 2 ? kind::shorthand_not_one_character :
+                                            s[1] >= '0' && s[1] <= '9' ? kind::shorthand_starts_with_number : kind::shorthand) :
+                   n >= 3 && s[2] == '-' ? kind::too_many_hyphens :
+                   n < 4 ? kind::long_name_too_short : kind::long_name;
+        }
+
+        _string_view name() const { return _string_view(data, size); }
+        std::string str() const { return std::string(data, size); }
+    };
+
+    // Names and description of an identifier. Never modified once created, so copies of an identifier share them
+    // and identifiers can be used from any context or thread
+    struct _identifier_names {
+        std::string short_name, long_name, pos_name; // Without hyphens, empty if not given
+        std::string sort_key; // Lowercase long or short name, only used for ordering
+        std::string descr;
+        int short_id = 0, long_id = 0, sort_id = 0; // Interned ids of short_name, long_name and sort_key, 0 if empty
+    };
 
     // Tests whether argument information matches one specified for fire::arg, compare fire::arg-s (that they are not overlapping),
     // create helpful names for fire::arg in help messages
     class identifier {
         optional<int> _pos;
-        optional<std::string> _short_name, _long_name, _pos_name, _descr;
+        std::shared_ptr<const _identifier_names> _names; // nullptr if there are neither names nor a description
         bool _variadic = false;
         bool _optional = false; // Only used for operator<
         bool _flag = false; // Only used for operator<
 
-        std::string _help, _longer;
-
     public:
         enum class type { not_specified=-1, positional=0, named=1, flag=2 };
 
         inline static std::string prepend_hyphens(const std::string &name);
 
         identifier() = default;
+        inline identifier(const _identifier_entry *begin, const _identifier_entry *end);
         inline identifier(const std::vector<std::string> &names, optional<int> pos, bool is_variadic = false);
 
         inline void set_as_flag() { _flag = true; }
 
-        inline void append_descr(const std::string &s) { if(_descr.has_value()) _descr = _descr.value() + " " + s; else _descr = s; }
+        inline void append_descr(const std::string &s);
 
-        inline optional<std::string> short_name() const { return _short_name; }
-        inline optional<std::string> long_name() const { return _long_name; }
+        inline optional<std::string> short_name() const;
+        inline optional<std::string> long_name() const;
+        inline const std::string& plain_short() const { return names().short_name; } // Without hyphens, empty if not given
+        inline const std::string& plain_long() const { return names().long_name; }
+        inline const std::string& sort_key() const { return names().sort_key; }
+        inline const std::string& positional_name() const { return names().pos_name; } // With angle brackets, empty if not given
+        inline int short_id() const { return names().short_id; } // Interned names, see _intern_name()
+        inline int long_id() const { return names().long_id; }
 
         inline type get_type() const;
         inline bool operator<(const identifier &other) const;
@@ -159,83 +415,236 @@ namespace fire {
         inline bool overlaps(const identifier &other) const;
         inline bool contains(const std::string &name) const;
         inline bool contains(int pos) const;
-        inline std::string help() const { return _help; }
-        inline std::string longer() const { return _longer; }
+        inline std::string help() const;
+        inline std::string longer() const;
+        inline void append_help(std::string &out) const;
+        inline void append_longer(std::string &out) const;
         inline optional<int> get_pos() const { return _pos; }
         inline void set_optional(bool optional) { _optional = optional; }
+        inline void set_pos(int pos) { _pos = pos; } // Unchecked, for identifiers without names
         inline bool variadic() const { return _variadic; }
 
-        inline std::string get_descr() const { return _descr.value_or(""); }
+        inline const std::string& get_descr() const { return names().descr; }
+
+    private:
+        inline const _identifier_names& names() const;
+    };
+
+    // Named arguments logged during introspection, compiled into tables that classify command line tokens in O(1)
+    class _option_table {
+    public:
+        enum class kind : unsigned char { unknown, flag, valued }; // Ordered: a name declared as both a flag and an option takes a value
+
+    private:
+        kind _short[256] = {}; // Indexed by the single character of a short name
+        std::vector<std::string> _long_names;
+        std::vector<kind> _long_kinds;
+        std::vector<size_t> _slots; // Open addressing hash table over _long_names, stores index + 1, 0 marks an empty slot
+
+        inline size_t find_slot(_string_view name) const;
+        inline void rehash(size_t slots);
+
+    public:
+        inline void add(int hyphens, _string_view name, kind k);
+        inline kind classify(int hyphens, _string_view name) const;
     };
 
     // Matches identifiers (from fire::arg) to actual command line arguments
     class _matcher {
         std::string _executable;
-        std::vector<std::string> _positional;
-        std::vector<std::pair<std::string, optional<std::string>>> _named;
-        std::vector<identifier> _queried;
+        std::vector<_token> _tokens;
+        std::vector<size_t> _positional; // Indices of positional tokens
+        std::unordered_map<_string_view, size_t, _string_view_hash> _short_index, _long_index; // Named token indices by name
+        std::vector<bool> _used; // Whether a token was matched by some query
+        std::vector<bool> _queried_names; // Indexed by interned name id
+        std::vector<bool> _queried_positions;
+        bool _queried_variadic = false;
         _smallest<identifier, std::string> _deferred_error;
         int _main_args = 0;
         bool _introspect = false;
         bool _strict = false;
         bool _help_flag = false;
+        _string_view _help_filter; // Value of --help=<substring>, points into argv
         bool _allow_unused = false;
+        bool _dry_run = false; // Leave fired_main() once all arguments are validated
 
     public:
         enum class arg_type { string_t, bool_t, none_t };
 
         inline _matcher() = default;
         inline _matcher(int argc, const char **argv, int main_args, bool strict, bool allow_unused);
+        inline void reset(int argc, const char **argv, int main_args, bool strict, bool allow_unused); // Keeps capacity
 
         inline void check(bool dec_main_args);
         inline void check_named();
         inline void check_positional();
         inline void set_allow_unused(bool allow_unused) { _allow_unused = allow_unused; }
 
-        inline std::pair<std::string, arg_type> get_and_mark_as_queried(const identifier &id);
+        inline std::pair<_string_view, arg_type> get_and_mark_as_queried(const identifier &id);
         inline void parse(int argc, const char **argv);
-        inline std::vector<std::string> to_vector_string(int n_strings, const char **strings);
-        inline std::vector<std::string> equate_assignments(
-                const std::vector<std::string> &raw, const std::vector<std::string> &assigned);
-        inline std::tuple<std::vector<std::string>, std::vector<std::string>>
-                separate_named_positional(const std::vector<std::string> &eqs);
-        inline std::vector<std::string> expand_single_hyphen(const std::vector<std::string> &named);
-        inline std::vector<std::pair<std::string, optional<std::string>>>
-                assign_named_values(const std::vector<std::string> &split);
+        inline static bool needs_introspection(int argc, const char **argv);
+        inline void tokenize(int argc, const char **argv, const _option_table &options);
+        inline void add_token(_token::kind k, int hyphens, _string_view name, _string_view value);
+        inline void index_tokens();
+        inline size_t find_named(const identifier &id) const;
+        inline void mark_as_queried(const identifier &id);
+        inline const std::vector<_token>& get_tokens() const { return _tokens; }
         inline const std::string& get_executable() { return _executable; }
         inline size_t pos_args() { return _positional.size(); }
-        inline bool deferred_assert(const identifier &id, bool pass, const std::string &msg); // Non-immediate assert (signals user error)
+        inline _string_view get_positional(size_t pos) const { return _tokens[_positional[pos]].value; }
+        inline size_t get_and_mark_variadic_as_queried();
+        inline bool deferred_assert(const identifier &id, bool pass, _string_view msg); // Non-immediate assert (signals user error)
+        template <typename F, typename std::enable_if<! std::is_convertible<F, _string_view>::value>::type* = nullptr>
+        inline bool deferred_assert(const identifier &id, bool pass, const F &msg_builder) {
+            if(! pass)
+                deferred_assert(id, false, msg_builder());
+            return pass;
+        }
 
         inline void set_introspect(bool introspect) { _introspect = introspect; }
         inline bool get_introspect() const { return _introspect; }
+        inline void set_dry_run(bool dry_run) { _dry_run = dry_run; }
 
         inline optional<std::string> match_named(const identifier &id) const;
     };
 
+    ///// Constraint classes for bound and one_of /////
+
+    // A single lower or upper bound, stored by value in the widest type of its kind
+    class _bound {
+    public:
+        enum class kind { none, signed_t, unsigned_t, floating_t };
+
+    private:
+        kind _kind = kind::none;
+        union {
+            long long _ll;
+            unsigned long long _ull;
+            long double _ld;
+        };
+
+    public:
+        inline _bound(): _ll(0) {}
+        template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type* = nullptr>
+        inline explicit _bound(T bound): _kind(kind::signed_t), _ll(bound) {}
+        template <typename T, typename std::enable_if<std::is_integral<T>::value && ! std::is_signed<T>::value>::type* = nullptr>
+        inline explicit _bound(T bound): _kind(kind::unsigned_t), _ull(bound) {}
+        template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
+        inline explicit _bound(T bound): _kind(kind::floating_t), _ld(bound) {}
+
+        inline kind get_kind() const { return _kind; }
+
+        template <typename V>
+        inline bool less_than(V val) const;
+        template <typename V>
+        inline bool greater_than(V val) const;
+        inline bool less_than(const _bound &other) const;
+        inline std::string str() const;
+    };
+
+    class _one_of {
+        std::vector<long long> ll_values;
+        std::vector<unsigned long long> ull_values; // Unsigned values are kept apart, so that none of them is narrowed
+        std::vector<long double> ld_values;
+        std::vector<std::string> s_values;
+
+        // Sorted once at construction for lookups, the above keep the user's order for error messages
+        std::vector<long long> ll_sorted;
+        std::vector<unsigned long long> ull_sorted;
+        std::vector<long double> ld_sorted;
+        std::vector<std::string> s_sorted;
+
+        std::shared_ptr<const _one_of> _previous; // Earlier one_of() constraint on the same argument
+
+        friend class _constraint_set;
+
+    public:
+        _one_of(std::vector<long long> ll_values, std::vector<unsigned long long> ull_values,
+                std::vector<long double> ld_values, std::vector<std::string> s_values):
+            ll_values(std::move(ll_values)), ull_values(std::move(ull_values)), ld_values(std::move(ld_values)), s_values(std::move(s_values)),
+            ll_sorted(_sorted(this->ll_values)), ull_sorted(_sorted(this->ull_values)), ld_sorted(_sorted(this->ld_values)),
+            s_sorted(_sorted(this->s_values)) {}
+
+        template <typename T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type* = nullptr>
+        explicit _one_of(std::vector<T> values): _one_of(std::vector<long long>(values.begin(), values.end()), {}, {}, {}) {}
+        template <typename T, typename std::enable_if<std::is_integral<T>::value && ! std::is_signed<T>::value>::type* = nullptr>
+        explicit _one_of(std::vector<T> values): _one_of({}, std::vector<unsigned long long>(values.begin(), values.end()), {}, {}) {}
+        template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
+        explicit _one_of(std::vector<T> values): _one_of({}, {}, std::vector<long double>(values.begin(), values.end()), {}) {}
+        template <typename T, typename std::enable_if<std::is_same<T, std::string>::value>::type* = nullptr>
+        explicit _one_of(std::vector<T> values): _one_of({}, {}, {}, std::move(values)) {}
+
+        template<typename T1, typename T2>
+        inline void check_constraint_template(const identifier &id, const std::string &type_name,
+                                              const std::vector<T1> &values, const std::vector<T1> &sorted, T2 cur_val) const;
+        template<typename T2>
+        inline void check_integral(const identifier &id, const std::string &type_name, T2 cur_val) const; // Against either integer set
+
+        inline void check_constraint(const identifier &id, long long val) const;
+        inline void check_constraint(const identifier &id, unsigned long long val) const;
+        inline void check_constraint(const identifier &id, long double val) const;
+        inline void check_constraint(const identifier &id, const std::string &val) const;
+
+        inline std::string help() const;
+    };
+
+    // All constraints of an argument. Repeated min()/max() calls keep only the tightest bound, and one_of() values are immutable
+    // once created, so copying an arg never allocates for its constraints
+    class _constraint_set {
+        _bound _lower, _upper;
+        bool _floating_bound = false; // Stays set even if an integral bound replaced the floating point one
+        std::shared_ptr<const _one_of> _one_of_values;
+
+        template <typename V>
+        inline void check_bound(const identifier &id, const _bound &bound, bool upper, V val) const;
+
+    public:
+        inline void add_bound(const _bound &bound, bool upper);
+        inline void add_one_of(_one_of values);
+
+        template <typename V, typename std::enable_if<std::is_arithmetic<V>::value>::type* = nullptr>
+        inline void check_constraints(const identifier &id, V val) const;
+        inline void check_constraints(const identifier &id, const std::string &val) const;
+
+        inline std::string help(const identifier &id) const; // Only formatted when help is printed
+    };
+
     // Gather function argument info from introspection
     class _arg_logger {
     public:
+        // Help text is formatted from these only in print_help(), descriptions are kept by the identifier
         struct elem {
             enum class type { none, string, integer, real };
 
-            std::string descr;
             type t;
-            std::string def;
             bool optional;
+            _bound def_number; // Numeric default value, kind::none if not given
+            bool has_def_string; // Whether def_string is given
+            std::string def_string; // String default value
+            _constraint_set constraints;
+
+            inline bool has_default() const { return def_number.get_kind() != _bound::kind::none || has_def_string; }
+            inline std::string default_str() const;
         };
 
     private:
         std::string _program_descr;
         std::vector<std::pair<identifier, elem>> _params;
         int _introspect_count = 0;
+        _option_table _options; // compile_options() result, valid while _options_current
+        bool _options_current = false;
+        bool _frozen = false; // Arguments are known, further log() calls are ignored
 
-        inline std::string _make_printable(const identifier &id, const elem &elem, bool verbose);
-        inline void _add_to_help(std::string &usage, std::string &options,
-                                 const identifier &id, const elem &elem, size_t margin);
+        inline void _append_printable(std::string &out, const identifier &id, const elem &elem, bool verbose) const;
+        inline void _append_description(std::string &out, const identifier &id, const elem &elem) const;
     public:
-        inline void print_help();
-        inline std::vector<std::string> get_assignment_arguments() const;
+        inline std::string help_text(_string_view filter = _string_view()) const; // Only arguments containing filter (case-insensitive) are listed
+        inline void print_help(_string_view filter = _string_view());
+        inline _option_table compile_options() const;
+        inline const _option_table& options();
         inline void log(const identifier &name, const elem &elem);
+        inline void freeze() { _frozen = true; }
+        inline bool frozen() const { return _frozen; }
         inline void set_introspect_count(int count);
         inline void set_program_descr(const std::string &program_descr) { _program_descr = program_descr; }
         inline int decrease_introspect_count();
@@ -243,77 +652,136 @@ namespace fire {
         inline optional<identifier> match_identifier(const identifier &id) const;
     };
 
-    // Static storage for matcher and logger
-    template <typename T_VOID = void>
-    struct _storage {
-        static _matcher matcher;
-        static _arg_logger logger;
+    // All state of parsing one command line. fire::arg conversions use the context active on the calling thread,
+    // so separate threads can parse at the same time, each with its own context
+    class context {
+    public:
+        _matcher matcher;
+        _arg_logger logger;
+        c_args raw_args;
+        _response_files response_files; // Storage of arguments read from @files
+        c_args expanded_args; // raw_args with @file arguments replaced by the files' words
+        error_policy on_error = error_policy::exit;
+        std::function<void(const error &)> reporter; // Receives errors and help instead of std::cerr, unless they're thrown
+        optional<error> last_error; // Error that ended the last fire::program call under error_policy::status
+        int escapable = 0; // Number of _call_escapable() calls in progress
+
+        context() = default;
+        context(const context &) = delete;
+        context& operator=(const context &) = delete;
+
+        // Makes a context active on the current thread for the scope's lifetime, restoring the previous one afterwards
+        class scope {
+            context *_previous;
+
+        public:
+            inline explicit scope(context &ctx);
+            inline ~scope();
+            scope(const scope &) = delete;
+            scope& operator=(const scope &) = delete;
+        };
     };
 
-    template <typename T_VOID>
-    _matcher _storage<T_VOID>::matcher;
-
-    template <typename T_VOID>
-    _arg_logger _storage<T_VOID>::logger;
+    // Access to the active context. Each thread falls back to its own default context, which FIRE(...) uses
+    template <typename T_VOID = void>
+    struct _storage {
+        static thread_local context *active;
 
-    using _ = _storage<void>;
+        static inline context& current() {
+            if(active == nullptr) {
+                static thread_local context default_context;
+                active = &default_context;
+            }
+            return *active;
+        }
 
-    struct variadic {
+        static _matcher& matcher() { return current().matcher; }
+        static _arg_logger& logger() { return current().logger; }
+        static c_args& raw_args() { return current().raw_args; }
+        static _response_files& response_files() { return current().response_files; }
+        static c_args& expanded_args() { return current().expanded_args; }
     };
 
-    ///// Constraint classes for bound and one_of /////
+    template <typename T_VOID>
+    thread_local context *_storage<T_VOID>::active = nullptr;
 
-    class _constraint {
-    public:
-        virtual std::unique_ptr<_constraint> clone() const = 0;
-        virtual void check_constraint(const identifier &, long long) const { _api_assert(false, "Constraint applied to wrong type argument (integral type)"); }
-        virtual void check_constraint(const identifier &, long double) const { _api_assert(false, "Constraint applied to wrong type argument (floating point type)"); }
-        virtual void check_constraint(const identifier &, const std::string &) const { _api_assert(false, "Constraint applied to wrong type argument (string type)"); }
-        virtual ~_constraint() = default;
-    };
+    using _ = _storage<void>;
 
-    template<typename T>
-    class _bound: public _constraint {
-        T bound;
-        bool upper;
+    context::scope::scope(context &ctx): _previous(_::active) {
+        _::active = &ctx;
+    }
 
-    public:
-        inline _bound(T bound, bool upper): bound(bound), upper(upper) {}
-        inline std::unique_ptr<_constraint> clone() const override { return std::unique_ptr<_constraint>(new _bound(bound, upper)); }
+    context::scope::~scope() {
+        _::active = _previous;
+    }
 
-        inline void check_constraint(const identifier &id, long long val) const override;
-        inline void check_constraint(const identifier &id, long double val) const override;
+    // Raw arguments of the active context
+    struct _active_raw_args {
+        int &argc() const { return _::raw_args().argc(); }
+        char ** argv() const { return _::raw_args().argv(); }
+        operator const c_args&() const { return _::raw_args(); }
+        c_args& expanded() const { return _::expanded_args(); } // With @file arguments replaced by the files' words
     };
 
-    class _one_of: public _constraint {
-        std::vector<long long> ll_values;
-        std::vector<long double> ld_values;
-        std::vector<std::string> s_values;
+    constexpr _active_raw_args raw_args = _active_raw_args();
 
-    public:
-        _one_of(std::vector<long long> ll_values, std::vector<long double> ld_values, std::vector<std::string> s_values):
-            ll_values(std::move(ll_values)), ld_values(std::move(ld_values)), s_values(std::move(s_values)) {}
+    // Leaves fired_main() before its body runs, back to the innermost _call_escapable(). Never called without exceptions:
+    // fired_main isn't introspected then (see _introspect()) and error policies other than exit require exceptions
+    [[noreturn]] inline void _escape() {
+#ifdef FIRE_EXCEPTIONS_ENABLED_
+        throw _escape_exception();
+#else
+        std::abort();
+#endif
+    }
 
-        template <typename T, typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
-        explicit _one_of(std::vector<T> values): _one_of(std::vector<long long>(values.begin(), values.end()), {}, {}) {}
-        template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
-        explicit _one_of(std::vector<T> values): _one_of({}, std::vector<long double>(values.begin(), values.end()), {}) {}
-        template <typename T, typename std::enable_if<std::is_same<T, std::string>::value>::type* = nullptr>
-        explicit _one_of(std::vector<T> values): _one_of({}, {}, std::move(values)) {}
+    template <typename F>
+    inline void _call_escapable(const F &f) {
+        context &ctx = _::current();
+        ++ctx.escapable;
+#ifdef FIRE_EXCEPTIONS_ENABLED_
+        try {
+            f();
+        } catch(_escape_exception) {
+        } catch(...) {
+            --ctx.escapable;
+            throw;
+        }
+#else
+        f();
+#endif
+        --ctx.escapable;
+    }
 
-        inline std::unique_ptr<_constraint> clone() const override { return std::unique_ptr<_constraint>(new _one_of(*this)); }
+    // Declares fired_main's arguments by calling it, its last default argument escapes before the body runs. Without
+    // exceptions it can't be left without skipping destructors, so it isn't introspected: named arguments are then
+    // unknown while parsing and their values must be supplied as an equation (`-x=1`, not `-x 1`)
+    template <typename F>
+    inline void _introspect(int main_args, const F &fired_main) {
+#ifdef FIRE_EXCEPTIONS_ENABLED_
+        _::logger().set_introspect_count(main_args);
+        _call_escapable(fired_main);
+#else
+        (void) main_args;
+        (void) fired_main;
+#endif
+    }
 
-        template<typename T1, typename T2>
-        inline void check_constraint_template(const identifier &id, const std::string &type_name, const std::vector<T1> &values, T2 cur_val) const;
+    // Reports an error and acts on the active context's error policy
+    [[noreturn]] inline void _fail(const error &e);
+    inline void _print_error(const error &e);
 
-        inline void check_constraint(const identifier &id, long long val) const override { check_constraint_template<long long, long long>(id, "integer", ll_values, val); }
-        inline void check_constraint(const identifier &id, long double val) const override;
-        inline void check_constraint(const identifier &id, const std::string &val) const override { check_constraint_template<std::string, std::string>(id, "string", s_values, val); }
-    };
+    // input_assert about the value of one argument, which is named in error::argument
+    template <typename F>
+    inline void _argument_assert(const identifier &id, bool pass, const F &msg_builder) {
+        if(! pass)
+            _fail(error(error::kind::input, _failure_code, id.longer(), msg_builder()));
+    }
 
     ///// fire-hpp's mechanics /////
 
-    // Can be converted to various types to get command line arguments. Actual conversion mechanics happen at _get() and _get_with_precision()
+    // Can be converted to various types to get command line arguments. Actual conversion mechanics happen at _get() and _get_with_precision(),
+    // which convert a value already queried from _matcher
     class arg {
         identifier _id; // No identifier implies vector positional arguments
 
@@ -321,20 +789,22 @@ namespace fire {
         optional<long double> _float_value;
         optional<std::string> _string_value;
 
-        std::vector<std::unique_ptr<_constraint>> _constraints;
+        _constraint_set _constraints;
 
         template<typename T>
-        inline void _check_constraints(T value) const;
+        inline void _check_constraints(const T &value) const;
+
+        using _queried_value = std::pair<_string_view, _matcher::arg_type>;
 
         template <typename T>
-        optional<T> _get() { T::unimplemented_function; } // no default function
+        optional<T> _get(const _queried_value &) { T::unimplemented_function; } // no default function
 
         template <typename T, typename std::enable_if<std::is_integral<T>::value && ! std::is_same<T, bool>::value>::type* = nullptr>
-        optional<T> _get_with_precision();
+        optional<T> _get_with_precision(const _queried_value &elem);
         template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type* = nullptr>
-        optional<T> _get_with_precision();
+        optional<T> _get_with_precision(const _queried_value &elem);
         template <typename T, typename std::enable_if<std::is_same<T, bool>::value || std::is_same<T, std::string>::value, bool>::type* = nullptr>
-        optional<T> _get_with_precision() { return _get<T>(); }
+        optional<T> _get_with_precision(const _queried_value &elem) { return _get<T>(elem); }
 
         template <typename T> optional<T> _convert_optional(bool dec_main_args=true);
         template <typename T> T _convert(bool dec_main_args=true);
@@ -347,37 +817,19 @@ namespace fire {
         inline void _init_default(const std::string &value) { _string_value = value; }
         inline void _init_default(std::nullptr_t) {}
 
-        inline arg() = default;
+        template <typename T, typename std::enable_if<std::is_arithmetic<T>::value>::type* = nullptr>
+        inline void _add_bound(T value, bool upper, const char *) { _constraints.add_bound(_bound(value), upper); }
+        template <typename T, typename std::enable_if<! std::is_arithmetic<T>::value>::type* = nullptr>
+        inline void _add_bound(T, bool, const char *caller);
 
-        struct convertible {
-            optional<int> _int_value;
-            optional<const char *> _char_value;
-            bool is_variadic = false;
+        inline arg() = default;
 
-            convertible(int value): _int_value(value) {}
-            convertible(const char *value): _char_value(value) {}
-            convertible(variadic): is_variadic(true) {}
-        };
+        using convertible = _identifier_entry;
 
     public:
-        inline arg(const arg &other) { *this = other; }
-        inline arg& operator=(const arg &other);
-
         template<typename T=std::nullptr_t>
-        inline arg(std::initializer_list<convertible> init, T value=T()) {
-            optional<int> int_value;
-            std::vector<std::string> string_values;
-            bool is_variadic = false;
-            for(const convertible &val: init) {
-                if(val.is_variadic)
-                    is_variadic = true;
-                else if(val._int_value.has_value())
-                    int_value = val._int_value.value();
-                else
-                    string_values.push_back(val._char_value.value());
-            }
-
-            _id = identifier(string_values, int_value, is_variadic);
+        inline arg(std::initializer_list<convertible> init, T value=T()):
+            _id(init.begin(), init.end()) {
             _init_default(value);
         }
 
@@ -401,40 +853,248 @@ namespace fire {
         template <typename T>
         inline operator std::vector<T>();
 
-        // Add constraints
+        // Add constraints. Chained calls on a temporary arg move it along instead of copying
+        template <typename T>
+        arg min(T mn) const & { return arg(*this).min(mn); }
         template <typename T>
-        arg min(T mn) const;
+        arg min(T mn) &&;
         template <typename T>
-        arg max(T mx) const;
+        arg max(T mx) const & { return arg(*this).max(mx); }
+        template <typename T>
+        arg max(T mx) &&;
+        template <typename T_min, typename T_max>
+        arg bounds(T_min mn, T_max mx) const & { return arg(*this).bounds(mn, mx); }
         template <typename T_min, typename T_max>
-        arg bounds(T_min mn, T_max mx) const;
+        arg bounds(T_min mn, T_max mx) &&;
 
         template<typename T>
-        arg one_of(const std::initializer_list<T> &values);
+        arg one_of(const std::initializer_list<T> &values) const & { return arg(*this).one_of(values); }
+        template<typename T>
+        arg one_of(const std::initializer_list<T> &values) &&;
+        template<typename T>
+        arg one_of(const std::vector<T> &values) const & { return arg(*this).one_of(values); }
+        template<typename T>
+        arg one_of(const std::vector<T> &values) &&;
+    };
+
+    // Options declared once as fields of a struct S, parsed in a single pass without calling fired_main for introspection
+    template <typename S>
+    class schema {
+        struct field {
+            arg declaration;
+            std::function<void(S &, arg)> assign;
+        };
+
+        std::vector<field> _fields;
+        std::string _program_descr;
+        bool _allow_unused;
+
+    public:
+        inline explicit schema(std::string program_descr = "", bool allow_unused = false):
+            _program_descr(std::move(program_descr)), _allow_unused(allow_unused) {}
+
+        template <typename T>
+        inline schema& add(T S::*member, arg declaration);
+        inline S parse(int argc, const char **argv) const;
+    };
+
+    // A fired_main introspected once, which then parses any number of command lines with the declarations kept
+    // in its own context. Usually created with FIRE_PROGRAM(fired_main[, program_description])
+    class program {
+        std::function<int()> _main; // Calls fired_main by name, so that its default arguments are used
+        int _main_args;
+        bool _allow_unused;
+        std::unique_ptr<context> _context;
+
+    public:
+        inline program(std::function<int()> fired_main, int main_args, const std::string &program_descr = "", bool allow_unused = false);
+
+        // Errors are handled by the program's context, see error_policy
+        inline int run(int argc, const char **argv); // Returns fired_main's return value
+#ifdef FIRE_EXCEPTIONS_ENABLED_
+        inline bool parse(int argc, const char **argv); // Converts and validates all arguments without running fired_main's body
+#endif
+        inline void set_error_policy(error_policy policy);
+
+        // Runs fired_main once for each line of shell-quoted arguments, executable taking the place of argv[0]. Each line
+        // exiting with a nonzero code is reported to std::cerr right away. Returns 0 if all lines succeeded
+        inline int run_batch(std::istream &in, const std::string &executable);
+        inline context& get_context() { return *_context; }
     };
 
+    // Entry of the table given to FIRE_SUBCOMMANDS: a fired_main selected by argv[1], introspected only when selected
+    struct subcommand {
+        const char *name;
+        const char *descr;
+        int (*run)(int argc, const char **argv); // Parses the arguments following the subcommand's name and calls fired_main
+    };
+
+    inline std::string _subcommands_help(const subcommand *begin, const subcommand *end, const std::string &executable, _string_view filter);
+    inline int _subcommands_main(const subcommand *begin, const subcommand *end, int argc, const char **argv);
+    inline _string_view _program_name(_string_view path); // File name without directories and .exe
+    inline int _multicall_main(const subcommand *begin, const subcommand *end, int argc, const char **argv);
+
     inline std::string helpful_name(const identifier &id);
     inline std::string helpful_name(int pos);
     inline std::string helpful_name(const std::string &name);
 
-    void _instant_assert(bool pass, const std::string &msg, bool programmer_side) {
+    void _instant_assert(bool pass, _string_view msg, bool programmer_side) {
         if (pass)
             return;
 
-        if (!msg.empty()) {
+        _fail(error(programmer_side ? error::kind::programmer : error::kind::input, _failure_code, "", msg.str()));
+    }
+
+    void _fail(const error &e) {
+        context &ctx = _::current();
+#ifdef FIRE_EXCEPTIONS_ENABLED_
+        if(ctx.on_error == error_policy::exception)
+            throw e;
+#else
+        // Without exceptions, recovering would have to leave fired_main's default arguments without destroying them
+        if(ctx.on_error != error_policy::exit) {
+            ctx.on_error = error_policy::exit;
+            _api_assert(false, "error policies other than error_policy::exit require exceptions");
+        }
+#endif
+        if(ctx.reporter)
+            ctx.reporter(e);
+        else
+            _print_error(e);
+
+        if(ctx.on_error != error_policy::exit && ctx.escapable > 0) {
+            ctx.last_error = e;
+            _escape();
+        }
+        exit(e.code);
+    }
+
+    void _print_error(const error &e) {
+        if(e.k == error::kind::help) {
+            std::cerr.write(e.message.data(), (std::streamsize) e.message.size());
+            std::cerr.flush();
+        } else if(! e.message.empty()) {
             std::cerr << "Error";
-            if(programmer_side)
+            if(e.k == error::kind::programmer)
                 std::cerr << " (programmer side)";
-            std::cerr << ": " << msg << std::endl;
+            std::cerr << ": " << e.message << std::endl;
         }
-
-        exit(_failure_code);
     }
 
-    inline void _api_assert(bool pass, const std::string &msg) { _instant_assert(pass, msg, true); }
+    inline void _api_assert(bool pass, _string_view msg) { _instant_assert(pass, msg, true); }
     inline void input_assert(bool pass, const std::string &msg) { _instant_assert(pass, msg, false); }
     inline void input_error(const std::string &msg) { _instant_assert(false, msg, false); }
 
+    template <typename T, typename std::enable_if<std::is_integral<T>::value>::type*>
+    _parse_result _from_chars(_string_view s, T &value) {
+        using U = typename std::make_unsigned<T>::type;
+
+        size_t i = 0;
+        bool negative = false;
+        if(i < s.size() && (s[i] == '-' || s[i] == '+'))
+            negative = s[i++] == '-';
+        if(i == s.size())
+            return _parse_result::invalid;
+
+        U limit = negative ? (U) (U(0) - (U) std::numeric_limits<T>::lowest()) : (U) std::numeric_limits<T>::max();
+        U result = 0;
+        bool overflow = false;
+        for(; i < s.size(); ++i) {
+            unsigned digit = (unsigned) (s[i] - '0');
+            if(digit > 9)
+                return _parse_result::invalid;
+            if(result > limit / 10 || (result == limit / 10 && digit > limit % 10))
+                overflow = true;
+            else
+                result = (U) (result * 10 + digit);
+        }
+        if(overflow)
+            return _parse_result::out_of_range;
+
+        value = negative ? (T) (U(0) - result) : (T) result;
+        return _parse_result::ok;
+    }
+
+    template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type*>
+    _parse_result _from_chars(_string_view s, T &value) {
+        // Accepts [+-]digits[.digits][(e|E)[+-]digits], with at least one mantissa digit
+        size_t i = 0;
+        bool negative = false;
+        if(i < s.size() && (s[i] == '-' || s[i] == '+'))
+            negative = s[i++] == '-';
+
+        unsigned long long mantissa = 0;
+        int exp10 = 0, digits = 0, significant = 0;
+        bool truncated = false;
+        for(bool fraction = false; i < s.size(); ++i) {
+            if(s[i] == '.' && ! fraction) {
+                fraction = true;
+                continue;
+            }
+            unsigned digit = (unsigned) (s[i] - '0');
+            if(digit > 9)
+                break;
+            ++digits;
+            if(significant < 19) { // 19 digits always fit into unsigned long long
+                mantissa = mantissa * 10 + digit;
+                significant += mantissa > 0;
+                exp10 -= fraction;
+            } else {
+                truncated |= digit != 0;
+                exp10 += ! fraction;
+            }
+        }
+        if(digits == 0)
+            return _parse_result::invalid;
+
+        if(i < s.size() && (s[i] == 'e' || s[i] == 'E')) {
+            ++i;
+            bool exp_negative = false;
+            if(i < s.size() && (s[i] == '-' || s[i] == '+'))
+                exp_negative = s[i++] == '-';
+            if(i == s.size())
+                return _parse_result::invalid;
+
+            int exp = 0;
+            for(; i < s.size(); ++i) {
+                unsigned digit = (unsigned) (s[i] - '0');
+                if(digit > 9)
+                    return _parse_result::invalid;
+                if(exp < 100000)
+                    exp = exp * 10 + (int) digit;
+            }
+            exp10 += exp_negative ? -exp : exp;
+        }
+        if(i != s.size())
+            return _parse_result::invalid;
+
+        // Fast path: both mantissa and the power of ten are exact in T, so a single rounding gives the correct result
+        constexpr int mantissa_digits = std::numeric_limits<T>::digits < 63 ? std::numeric_limits<T>::digits : 63;
+        constexpr int max_pow10 = _max_exact_pow10(std::numeric_limits<T>::digits);
+        if(mantissa == 0) {
+            value = negative ? -T(0) : T(0);
+            return _parse_result::ok;
+        }
+        if(! truncated && (mantissa >> mantissa_digits) == 0 && -max_pow10 <= exp10 && exp10 <= max_pow10) {
+            T pow10 = 1;
+            for(int k = 0; k < exp10 || k < -exp10; ++k)
+                pow10 *= 10;
+            T result = exp10 < 0 ? (T) mantissa / pow10 : (T) mantissa * pow10;
+            value = negative ? -result : result;
+            return _parse_result::ok;
+        }
+
+        // Slow path: syntax has already been validated, let the C locale's conversion do correct rounding
+        std::istringstream stream(s.str());
+        stream.imbue(std::locale::classic());
+        T result = 0;
+        stream >> result;
+        if(stream.fail() || result < std::numeric_limits<T>::lowest() || result > std::numeric_limits<T>::max())
+            return _parse_result::out_of_range;
+        value = result;
+        return _parse_result::ok;
+    }
+
     int _count_hyphens(const std::string &s) {
         int hyphens;
         for(hyphens = 0; hyphens < (int) s.size() && s[hyphens] == '-'; ++hyphens)
@@ -459,6 +1119,73 @@ namespace fire {
         return ret;
     }
 
+    template <typename OUT>
+    bool _split_shell_words(_string_view text, OUT &out) {
+        // Each character is read before any output is written at its position, so out may overwrite text as it goes
+        bool in_word = false;
+        for(size_t i = 0; i < text.size(); ++i) {
+            char c = text[i];
+            if(c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                if(in_word)
+                    out.end_word();
+                in_word = false;
+                continue;
+            }
+            if(c == '#' && ! in_word) { // Comment until the end of the line
+                while(i + 1 < text.size() && text[i + 1] != '\n')
+                    ++i;
+                continue;
+            }
+
+            if(! in_word)
+                out.begin_word();
+            in_word = true;
+
+            if(c == '\\') {
+                if(i + 1 < text.size())
+                    ++i;
+                out.push(text[i]);
+            } else if(c == '\'') {
+                for(++i; i < text.size() && text[i] != '\''; ++i)
+                    out.push(text[i]);
+                if(i == text.size())
+                    return false;
+            } else if(c == '"') {
+                for(++i; i < text.size() && text[i] != '"'; ++i) {
+                    char next = i + 1 < text.size() ? text[i + 1] : '\0';
+                    if(text[i] == '\\' && (next == '\\' || next == '"' || next == '$' || next == '`'))
+                        ++i;
+                    out.push(text[i]);
+                }
+                if(i == text.size())
+                    return false;
+            } else {
+                out.push(c);
+            }
+        }
+        if(in_word)
+            out.end_word();
+        return true;
+    }
+
+    bool _split_shell_words(_string_view line, std::vector<std::string> &words, size_t &count) {
+        struct word_list {
+            std::vector<std::string> &words;
+            size_t &count;
+            std::string *word;
+
+            void begin_word() {
+                if(count == words.size())
+                    words.emplace_back();
+                word = &words[count++];
+                word->clear();
+            }
+            void push(char c) { word->push_back(c); }
+            void end_word() {}
+        } out{words, count, nullptr};
+        return _split_shell_words(line, out);
+    }
+
 
     template<typename ORDER, typename VALUE>
     void _smallest<ORDER, VALUE>::set(const ORDER &order, const VALUE &value) {
@@ -475,6 +1202,30 @@ namespace fire {
     }
 
 
+    _string_view _string_view::substr(size_t pos, size_t count) const {
+        pos = std::min(pos, _size);
+        return _string_view(_data + pos, std::min(count, _size - pos));
+    }
+
+    size_t _string_view::find(char c, size_t pos) const {
+        if(pos >= _size)
+            return std::string::npos;
+        const void *found = memchr(_data + pos, c, _size - pos); // Vectorized by the C library, matters for long arguments
+        return found ? (size_t) ((const char *) found - _data) : std::string::npos;
+    }
+
+    bool _string_view::operator==(const _string_view &other) const {
+        return _size == other._size && std::equal(begin(), end(), other.begin());
+    }
+
+    size_t _string_view_hash::operator()(_string_view s) const {
+        unsigned long long hash = 14695981039346656037ULL; // FNV-1a
+        for(char c: s)
+            hash = (hash ^ (unsigned char) c) * 1099511628211ULL;
+        return (size_t) hash;
+    }
+
+
     c_args::c_args(const std::string &executable, const std::vector<std::string> &args) {
         std::vector<std::string> all_args;
         all_args.push_back(executable);
@@ -482,6 +1233,7 @@ namespace fire {
 
         _argc = (int) all_args.size();
         _argv = new char*[all_args.size() + 1]();
+        _owned = true;
 
         for(size_t i = 0; i < all_args.size(); ++i) {
             _argv[i] = new char[all_args[i].size() + 1]();
@@ -495,6 +1247,7 @@ namespace fire {
         delete_storage();
         _argc = other._argc;
         _argv = new char*[_argc + 1]();
+        _owned = true;
 
         for(int i = 0; i < _argc; ++i) {
             _argv[i] = new char[strlen(other._argv[i]) + 1]();
@@ -504,14 +1257,38 @@ namespace fire {
         return *this;
     }
 
+    c_args& c_args::operator=(c_args &&other) noexcept {
+        if(this == &other) return *this;
+
+        delete_storage();
+        _argc = other._argc;
+        _argv = other._argv;
+        _owned = other._owned;
+
+        other._argc = 0;
+        other._argv = nullptr;
+        other._owned = false;
+        return *this;
+    }
+
     c_args::~c_args() {
         delete_storage();
     }
 
+    void c_args::view(int argc, const char **argv) {
+        delete_storage();
+        _argc = argc;
+        _argv = const_cast<char **>(argv);
+        _owned = false;
+    }
+
     void c_args::delete_storage() {
-        for(int i = 0; i < _argc; ++i)
-            delete [] _argv[i];
-        delete [] _argv;
+        if(_owned) {
+            for(int i = 0; i < _argc; ++i)
+                delete [] _argv[i];
+            delete [] _argv;
+        }
+        _argv = nullptr;
         _argc = 0;
     }
 
@@ -525,79 +1302,158 @@ namespace fire {
     }
 
     inline identifier::identifier(const std::vector<std::string> &names, optional<int> pos, bool is_variadic) {
-        _variadic = is_variadic;
-
-        // Find description, shorthand and long name
-        for(const std::string &name: names) {
-            if(name.size() >= 2 && name.front() == '<' && name.back() == '>') {
-                _pos_name = name;
-                continue;
-            }
+        std::vector<_identifier_entry> entries;
+        for(const std::string &name: names)
+            entries.emplace_back(name.data(), name.size());
+        if(pos.has_value())
+            entries.emplace_back(pos.value());
+        if(is_variadic)
+            entries.emplace_back(fire::variadic());
+        *this = identifier(entries.data(), entries.data() + entries.size());
+    }
 
-            int hyphens = _count_hyphens(name);
-            _api_assert(hyphens <= 2, "Identifier entry " + name + " must prefix either:"
-                                                                   " 0 hyphens for description,"
-                                                                   " 1 hyphen for short-hand name"
-                                                                   " 2 hyphens for long name");
-            if(hyphens == 0) {
-                _api_assert(!_descr.has_value(),
-                            "Can't specify descriptions twice: " + _descr.value_or("") + " and " + name);
-                _descr = name;
-            } else if(hyphens == 1) {
-                _api_assert(!_short_name.has_value(),
-                            "Can't specify shorthands twice: " + _short_name.value_or("") + " and " + name);
-                _api_assert(name.size() == 2,
-                            "Single hyphen shorthand " + name + " must be one character");
-                _api_assert(!isdigit(name[1]),
-                            "Argument " + name + " can't start with a number");
-                _short_name = name;
-            } else if(hyphens == 2) {
-                _api_assert(!_long_name.has_value(),
-                            "Can't specify long names twice: " + _long_name.value_or("") + " and " + name);
-                _api_assert(name.size() >= 4,
-                            "Two hyphen name " + name + " must have at least two characters");
-                _long_name = name;
+    inline identifier::identifier(const _identifier_entry *begin, const _identifier_entry *end) {
+        using kind = _identifier_entry::kind;
+        const _identifier_entry *short_name = nullptr, *long_name = nullptr, *pos_name = nullptr, *descr = nullptr;
+
+        // Entries were classified on construction, only combinations are checked here
+        for(const _identifier_entry *entry = begin; entry != end; ++entry) {
+            switch(entry->k) {
+            case kind::description:
+                _api_assert(descr == nullptr,
+                            [&]{ return "Can't specify descriptions twice: " + descr->str() + " and " + entry->str(); });
+                descr = entry;
+                break;
+            case kind::shorthand:
+                _api_assert(short_name == nullptr,
+                            [&]{ return "Can't specify shorthands twice: " + short_name->str() + " and " + entry->str(); });
+                short_name = entry;
+                break;
+            case kind::long_name:
+                _api_assert(long_name == nullptr,
+                            [&]{ return "Can't specify long names twice: " + long_name->str() + " and " + entry->str(); });
+                long_name = entry;
+                break;
+            case kind::positional_name: pos_name = entry; break;
+            case kind::index: _pos = entry->index; break;
+            case kind::variadic: _variadic = true; break;
+            case kind::too_many_hyphens:
+                _api_assert(false, [&]{ return "Identifier entry " + entry->str() + " must prefix either:"
+                                                                                    " 0 hyphens for description,"
+                                                                                    " 1 hyphen for short-hand name"
+                                                                                    " 2 hyphens for long name"; });
+                break;
+            case kind::shorthand_not_one_character:
+                _api_assert(false, [&]{ return "Single hyphen shorthand " + entry->str() + " must be one character"; });
+                break;
+            case kind::shorthand_starts_with_number:
+                _api_assert(false, [&]{ return "Argument " + entry->str() + " can't start with a number"; });
+                break;
+            case kind::long_name_too_short:
+                _api_assert(false, [&]{ return "Two hyphen name " + entry->str() + " must have at least two characters"; });
+                break;
             }
         }
 
+        _identifier_names names;
+        if(descr != nullptr)
+            names.descr = descr->str();
+
         // Variadic argument
         if(_variadic) {
-            _api_assert(!_short_name.has_value() && !_long_name.has_value()
-                        && !_pos.has_value() && !_pos_name.has_value(),
+            _api_assert(short_name == nullptr && long_name == nullptr && !_pos.has_value() && pos_name == nullptr,
                         "Can't assign a name or position to variadic arguments");
-            _help = _longer = "...";
+            if(descr != nullptr)
+                _names = std::make_shared<const _identifier_names>(std::move(names));
             return;
         }
 
-        // Set help and longer variant
-        if(_long_name.has_value() && _short_name.has_value()) {
-            _help = _short_name.value() + "|" + _long_name.value();
-            _longer = _long_name.value();
-        } else if (_long_name.has_value() && ! _short_name.has_value())
-            _help = _longer = _long_name.value();
-        else if (! _long_name.has_value() && _short_name.has_value())
-            _help = _longer = _short_name.value();
-
-        // Set position
-        if(pos.has_value()) {
-            _api_assert(!_short_name.has_value(),
-                        "Can't specify both name " + _short_name.value_or("") + " and index " +
-                        std::to_string(pos.value()));
-            _api_assert(!_long_name.has_value(),
-                        "Can't specify both name " + _long_name.value_or("") + " and index " +
-                        std::to_string(pos.value()));
-            _pos = pos;
-            if(_pos_name.has_value())
-                _longer = _help = _pos_name.value();
-            else
-                _longer = _help = "<" + std::to_string(pos.value()) + ">";
+        // Position excludes names
+        if(_pos.has_value()) {
+            _api_assert(short_name == nullptr,
+                        [&]{ return "Can't specify both name " + short_name->str() + " and index " + std::to_string(_pos.value()); });
+            _api_assert(long_name == nullptr,
+                        [&]{ return "Can't specify both name " + long_name->str() + " and index " + std::to_string(_pos.value()); });
         }
-        _api_assert(_short_name.has_value() || _long_name.has_value() || _pos.has_value(),
+        _api_assert(short_name != nullptr || long_name != nullptr || _pos.has_value(),
                     "Argument must be specified with at least on of the following: shorthand, long name or index");
 
-        if(_pos_name.has_value())
+        if(pos_name != nullptr)
             _api_assert(_pos.has_value(),
-                        "Positional name " + _pos_name.value_or("") + " requires the argument to be positional");
+                        [&]{ return "Positional name " + pos_name->str() + " requires the argument to be positional"; });
+
+        if(short_name != nullptr)
+            names.short_name = short_name->name().substr(1).str();
+        if(long_name != nullptr)
+            names.long_name = long_name->name().substr(2).str();
+        if(pos_name != nullptr)
+            names.pos_name = pos_name->str();
+
+        names.sort_key = long_name != nullptr ? names.long_name : names.short_name;
+        std::transform(names.sort_key.begin(), names.sort_key.end(), names.sort_key.begin(), [](char c){ return (char) tolower(c); });
+        names.short_id = _intern_name(names.short_name);
+        names.long_id = _intern_name(names.long_name);
+        names.sort_id = _intern_name(names.sort_key);
+        if(descr != nullptr || short_name != nullptr || long_name != nullptr || pos_name != nullptr)
+            _names = std::make_shared<const _identifier_names>(std::move(names));
+    }
+
+    inline const _identifier_names& identifier::names() const {
+        static const _identifier_names none;
+        return _names ? *_names : none;
+    }
+
+    inline optional<std::string> identifier::short_name() const {
+        return plain_short().empty() ? optional<std::string>() : "-" + plain_short();
+    }
+
+    inline optional<std::string> identifier::long_name() const {
+        return plain_long().empty() ? optional<std::string>() : "--" + plain_long();
+    }
+
+    inline void identifier::append_descr(const std::string &s) {
+        // Copies share the names, so the description is changed on a copy of them
+        _identifier_names names = this->names();
+        if(! names.descr.empty())
+            names.descr += ' ';
+        names.descr += s;
+        _names = std::make_shared<const _identifier_names>(std::move(names));
+    }
+
+    inline std::string identifier::help() const {
+        std::string out;
+        append_help(out);
+        return out;
+    }
+
+    inline std::string identifier::longer() const {
+        std::string out;
+        append_longer(out);
+        return out;
+    }
+
+    inline void identifier::append_help(std::string &out) const {
+        if(! plain_short().empty() && ! plain_long().empty()) {
+            out += '-';
+            out += plain_short();
+            out += "|--";
+            out += plain_long();
+        } else {
+            append_longer(out);
+        }
+    }
+
+    inline void identifier::append_longer(std::string &out) const {
+        if(_variadic)
+            out += "...";
+        else if(_pos.has_value() && ! names().pos_name.empty())
+            out += names().pos_name;
+        else if(_pos.has_value())
+            out += "<" + std::to_string(_pos.value()) + ">";
+        else if(! plain_long().empty())
+            out.append("--").append(plain_long());
+        else if(! plain_short().empty())
+            out.append("-").append(plain_short());
     }
 
     inline identifier::type identifier::get_type() const {
@@ -612,34 +1468,25 @@ namespace fire {
         if(get_type() != other.get_type())
             return (int) get_type() < (int) other.get_type();
 
-        std::string name = _long_name.value_or(_short_name.value_or(""));
-        std::string other_name = other._long_name.value_or(other._short_name.value_or(""));
-
-        name = _without_hyphens(name);
-        other_name = _without_hyphens(other_name);
-
-        std::transform(name.begin(), name.end(), name.begin(), [](char c){ return (char) tolower(c); });
-        std::transform(other_name.begin(), other_name.end(), other_name.begin(), [](char c){ return (char) tolower(c); });
-
-        if(name != other_name) {
-            if(!name.empty() && !other_name.empty() && _optional != other._optional)
+        int sort_id = names().sort_id, other_sort_id = other.names().sort_id;
+        if(sort_id != other_sort_id) { // Strings are only compared to order different names
+            if(sort_id != 0 && other_sort_id != 0 && _optional != other._optional)
                 return _optional < other._optional;
-            return name < other_name;
+            return sort_key() < other.sort_key();
         }
         return _pos.value_or(1000000) < other._pos.value_or(1000000);
     }
 
     bool identifier::operator==(const identifier &other) const {
-        return _pos == other._pos && _short_name == other._short_name && _long_name == other._long_name && _variadic == other._variadic;
+        return _pos == other._pos && short_id() == other.short_id() && long_id() == other.long_id() &&
+               _variadic == other._variadic;
     }
 
     bool identifier::overlaps(const identifier &other) const {
-        if(_long_name.has_value() && other._long_name.has_value())
-            if(_long_name.value() == other._long_name.value())
-                return true;
-        if(_short_name.has_value() && other._short_name.has_value())
-            if(_short_name.value() == other._short_name.value())
-                return true;
+        if(long_id() != 0 && long_id() == other.long_id())
+            return true;
+        if(short_id() != 0 && short_id() == other.short_id())
+            return true;
         if(_pos.has_value() && other._pos.has_value())
             if(_pos.value() == other._pos.value())
                 return true;
@@ -647,8 +1494,10 @@ namespace fire {
     }
 
     bool identifier::contains(const std::string &name) const {
-        if(_short_name.has_value() && name == _short_name.value()) return true;
-        if(_long_name.has_value() && name == _long_name.value()) return true;
+        int hyphens = _count_hyphens(name);
+        _string_view plain = _string_view(name).substr((size_t) hyphens);
+        if(hyphens == 1 && ! plain_short().empty() && plain == plain_short()) return true;
+        if(hyphens == 2 && ! plain_long().empty() && plain == plain_long()) return true;
         return false;
     }
 
@@ -657,14 +1506,52 @@ namespace fire {
     }
 
 
+    int _name_table::intern(_string_view name) {
+        auto it = _ids.find(name);
+        if(it != _ids.end())
+            return it->second;
+        _names.push_back(name.str());
+        int id = (int) _names.size() - 1;
+        _ids.emplace(_string_view(_names.back()), id);
+        return id;
+    }
+
+    int _name_table::find(_string_view name) const {
+        auto it = _ids.find(name);
+        return it != _ids.end() ? it->second : -1;
+    }
+
+    int _intern_name(_string_view name) {
+        if(name.empty())
+            return 0;
+        static std::mutex mutex;
+        static _name_table table;
+        std::lock_guard<std::mutex> lock(mutex);
+        return table.intern(name);
+    }
+
+
     _matcher::_matcher(int argc, const char **argv, int main_args, bool strict, bool allow_unused) {
+        reset(argc, argv, main_args, strict, allow_unused);
+    }
+
+    void _matcher::reset(int argc, const char **argv, int main_args, bool strict, bool allow_unused) {
         _main_args = main_args;
         _strict = strict;
         _allow_unused = allow_unused;
+        _introspect = false;
+        _dry_run = false;
+        _queried_variadic = false;
+        _queried_names.assign(_queried_names.size(), false);
+        _queried_positions.assign(_queried_positions.size(), false);
+        _deferred_error = _smallest<identifier, std::string>();
 
         parse(argc, argv);
-        identifier help({"-h", "--help", "Print the help message"}, optional<int>());
-        _help_flag = get_and_mark_as_queried(help).second != arg_type::none_t;
+        static const _identifier_entry help_entries[] = {"-h", "--help", "Print the help message"};
+        static const identifier help(help_entries, help_entries + 3); // Identifiers don't depend on the context, so one is shared
+        std::pair<_string_view, arg_type> help_value = get_and_mark_as_queried(help);
+        _help_flag = help_value.second != arg_type::none_t;
+        _help_filter = help_value.first;
         check(false);
     }
 
@@ -674,351 +1561,644 @@ namespace fire {
 
         if(! _strict || _main_args > 0) return;
 
-        if(_help_flag) {
-            _::logger.print_help();
-            exit(0);
-        }
+        if(_help_flag)
+            _fail(error(error::kind::help, 0, "", _::logger().help_text(_help_filter)));
 
         if(! _allow_unused) {
             check_named();
             check_positional();
         }
 
-        if(! _deferred_error.empty()) {
-            std::cerr << "Error: " << _deferred_error.get() << std::endl;
-            exit(_failure_code);
-        }
+        if(! _deferred_error.empty())
+            _fail(error(error::kind::input, _failure_code, _deferred_error.get_order().longer(), _deferred_error.get()));
+
+        if(_dry_run)
+            _escape();
     }
 
     void _matcher::check_named() {
         int invalid_count = 0;
         std::string invalid;
-        for(const auto &it: _named) {
-            for(const auto &jt: _queried)
-                if(jt.contains(it.first))
-                    goto VALID;
-
-            ++invalid_count;
-            invalid += " " + it.first;
-            VALID:;
-        }
+        for(size_t i = 0; i < _tokens.size(); ++i)
+            if(_tokens[i].k != _token::kind::positional && ! _used[i]) {
+                ++invalid_count;
+                invalid += ' ';
+                invalid += _tokens[i].name_with_hyphens();
+            }
         deferred_assert(identifier(), invalid.empty(),
-                        std::string("invalid argument") + (invalid_count > 1 ? "s" : "") + invalid);
+                        [&]{ return std::string("invalid argument") + (invalid_count > 1 ? "s" : "") + invalid; });
     }
 
     void _matcher::check_positional() {
         int invalid_count = 0;
         std::string invalid;
-        for(size_t i = 0; i < _positional.size(); ++i) {
-            for(const auto &it: _queried)
-                if(it.contains((int) i))
-                    goto VALID;
-
-            ++invalid_count;
-            invalid += " " + _positional[i];
-            VALID:;
-        }
+        for(size_t i: _positional)
+            if(! _used[i]) {
+                ++invalid_count;
+                invalid += ' ';
+                invalid.append(_tokens[i].value.data(), _tokens[i].value.size());
+            }
         deferred_assert(identifier(), invalid.empty(),
-                        std::string("invalid positional argument") + (invalid_count > 1 ? "s" : "") + invalid);
+                        [&]{ return std::string("invalid positional argument") + (invalid_count > 1 ? "s" : "") + invalid; });
     }
 
-    std::pair<std::string, _matcher::arg_type> _matcher::get_and_mark_as_queried(const identifier &id) {
-        if(_strict)
-            for(const auto& it: _queried)
-                _api_assert(!it.overlaps(id), "double query for argument " + id.longer());
-        _queried.push_back(id);
-
-        for(auto it = _named.begin(); it != _named.end(); ++it) {
-            if (id.contains(it->first)) {
-                optional<std::string> result = it->second;
-                if (result.has_value())
-                    return {result.value(), arg_type::string_t};
-                return {"", arg_type::bool_t};
-            }
+    std::pair<_string_view, _matcher::arg_type> _matcher::get_and_mark_as_queried(const identifier &id) {
+        mark_as_queried(id);
+
+        size_t index = find_named(id);
+        if(index < _tokens.size()) {
+            if(_tokens[index].k == _token::kind::named)
+                return {_tokens[index].value, arg_type::string_t};
+            return {_string_view(), arg_type::bool_t};
         }
 
         if(id.get_pos().has_value()) {
             size_t pos = id.get_pos().value();
             if(pos >= _positional.size())
-                return {"", arg_type::none_t};
+                return {_string_view(), arg_type::none_t};
 
-            return {_positional[pos], arg_type::string_t};
+            return {_tokens[_positional[pos]].value, arg_type::string_t};
         }
 
-        return {"", arg_type::none_t};
+        return {_string_view(), arg_type::none_t};
     }
 
-    void _matcher::parse(int argc, const char **argv) {
-        _executable = argv[0];
-        std::vector<std::string> raw = to_vector_string(argc - 1, argv + 1);
-        raw_args = c_args(_executable, raw);
-        std::vector<std::string> eqs = equate_assignments(raw, _::logger.get_assignment_arguments());
-        std::vector<std::string> named;
-        tie(named, _positional) = separate_named_positional(eqs);
-        named = expand_single_hyphen(named);
-        _named = assign_named_values(named);
-
-        for(size_t i = 0; i < _named.size(); ++i)
-            for(size_t j = 0; j < i; ++j)
-                deferred_assert(identifier(), _named[i].first != _named[j].first,
-                                "multiple occurrences of argument " + identifier::prepend_hyphens(_named[i].first));
-    }
-
-    std::vector<std::string> _matcher::to_vector_string(int n_strings, const char **strings) {
-        std::vector<std::string> raw(n_strings);
-        for(int i = 0; i < n_strings; ++i)
-            raw[i] = strings[i];
-        return raw;
-    }
-
-    std::vector<std::string> _matcher::equate_assignments(
-            const std::vector<std::string> &raw, const std::vector<std::string> &assigned) {
-        std::vector<std::string> eqs;
-        size_t i = 0;
-        while(i < raw.size()) {
-            // Don't parse options after "--"
-            if(raw[i] == "--" || (i + 1 < raw.size() && raw[i + 1] == "--")) {
-                eqs.insert(eqs.end(), raw.begin() + i, raw.end());
-                break;
+    void _matcher::mark_as_queried(const identifier &id) {
+        auto mark_name = [this, &id](const std::string &name, int interned, const decltype(_short_index) &index) {
+            if(name.empty())
+                return;
+            if(_strict) {
+                size_t name_id = (size_t) interned;
+                if(name_id >= _queried_names.size())
+                    _queried_names.resize(name_id + 1);
+                bool inserted = ! _queried_names[name_id];
+                _queried_names[name_id] = true;
+                _api_assert(inserted, [&]{ return "double query for argument " + id.longer(); });
             }
 
-            // Parse `make -j8` as `make -j=8`
-            if(_count_hyphens(raw[i]) == 1 && raw[i].size() > 2 && raw[i][2] != '=') {
-                std::string prefix = raw[i].substr(0, 2);
-                if(std::find(assigned.begin(), assigned.end(), prefix) != assigned.end()) {
-                    eqs.push_back(prefix + "=" + raw[i].substr(2));
-                    ++i;
-                    continue;
-                }
-            }
+            auto it = index.find(name);
+            if(it != index.end())
+                _used[it->second] = true;
+        };
+        mark_name(id.plain_short(), id.short_id(), _short_index);
+        mark_name(id.plain_long(), id.long_id(), _long_index);
 
-            // Parse `make -j 8` as `make -j=8`
-            if(i < raw.size() - 1 && std::find(assigned.begin(), assigned.end(), raw[i]) != assigned.end()) {
-                eqs.push_back(raw[i] + "=" + raw[i + 1]);
-                i += 2;
-                continue;
+        if(id.get_pos().has_value()) {
+            int pos = id.get_pos().value();
+            bool inserted = true;
+            if(pos >= 0) {
+                if((size_t) pos >= _queried_positions.size())
+                    _queried_positions.resize((size_t) pos + 1);
+                inserted = ! _queried_positions[pos];
+                _queried_positions[pos] = true;
             }
+            if(_strict)
+                _api_assert(inserted && ! _queried_variadic, [&]{ return "double query for argument " + id.longer(); });
+            if(pos < (int) _positional.size())
+                _used[_positional[pos]] = true;
+        }
+    }
 
-            // Parse flags without modification
-            eqs.push_back(raw[i]);
-            ++i;
+    size_t _matcher::get_and_mark_variadic_as_queried() {
+        if(_strict)
+            _api_assert(! _queried_variadic && std::find(_queried_positions.begin(), _queried_positions.end(), true) == _queried_positions.end(),
+                        "double query for variadic argument");
+        _queried_variadic = true;
+
+        for(size_t i: _positional)
+            _used[i] = true;
+        return _positional.size();
+    }
+
+    size_t _matcher::find_named(const identifier &id) const {
+        // If both short and long name are given, the first occurrence counts
+        size_t first = _tokens.size();
+        if(! id.plain_short().empty()) {
+            auto it = _short_index.find(id.plain_short());
+            if(it != _short_index.end())
+                first = std::min(first, it->second);
+        }
+        if(! id.plain_long().empty()) {
+            auto it = _long_index.find(id.plain_long());
+            if(it != _long_index.end())
+                first = std::min(first, it->second);
         }
+        return first;
+    }
 
-        return eqs;
+    bool _matcher::needs_introspection(int argc, const char **argv) {
+        // Declared names only matter for `-j8` and `-j 8`/`--name value` style tokens, other tokens are classified from argv alone
+        for(int i = 1; i < argc; ++i) {
+            _arg_shape shape(argv[i]);
+            if(shape.s == "--")
+                return false;
+            if(_response_files::is_file(argv[i])) // Contents are only known once read
+                return true;
+            if(shape.hyphens < 1 || shape.hyphens > 2 || shape.negative_number)
+                continue;
+            if(shape.hyphens == 1 && shape.s.size() > 2 && shape.s[2] != '=')
+                return true;
+            if(shape.eq() == std::string::npos && i + 1 < argc && strcmp(argv[i + 1], "--") != 0)
+                return true;
+        }
+        return false;
     }
 
-    std::tuple<std::vector<std::string>, std::vector<std::string>>
-            _matcher::separate_named_positional(const std::vector<std::string> &eqs) {
-        std::vector<std::string> named, positional;
+    void _matcher::parse(int argc, const char **argv) {
+        _executable = argv[0];
+        _::raw_args().view(argc, argv);
+        for(int i = 1; i < argc && strcmp(argv[i], "--") != 0; ++i) {
+            if(_response_files::is_file(argv[i])) {
+                _response_files &files = _::response_files();
+                std::string error = files.expand(argc, argv, _::logger().options());
+                deferred_assert(identifier(), error.empty(), error);
+                argc = files.argc();
+                argv = files.argv();
+                break;
+            }
+        }
+        _::expanded_args().view(argc, argv);
+        tokenize(argc, argv, _::logger().options());
+        index_tokens();
+    }
 
-        for(size_t i = 0; i < eqs.size(); ++i) {
-            const std::string &s = eqs[i];
-            int hyphens = _count_hyphens(s);
+    void _matcher::tokenize(int argc, const char **argv, const _option_table &options) {
+        auto is_assigned = [&options](int hyphens, _string_view name) {
+            return options.classify(hyphens, name) == _option_table::kind::valued;
+        };
 
+        _tokens.clear();
+        _positional.clear();
+        _tokens.reserve((size_t) std::max(argc - 1, 0)); // Exact unless `-abc` expands
+        int i = 1;
+        for(; i < argc; ++i) {
+            _arg_shape shape(argv[i]);
+            _string_view s = shape.s;
+            int hyphens = shape.hyphens;
             if(s == "--") { // Double dash indicates that upcoming arguments are positional only
-                positional.insert(positional.end(), eqs.begin() + i + 1, eqs.end());
+                ++i;
                 break;
             }
 
-            if(! _allow_unused)
-                deferred_assert(identifier(), hyphens <= 2, "too many hyphens: " + s);
+            // Parse `make -j8` as `make -j=8`
+            if(hyphens == 1 && s.size() > 2 && s[2] != '=' && is_assigned(1, s.substr(1, 1))) {
+                add_token(_token::kind::named, 1, s.substr(1, 1), s.substr(2));
+                continue;
+            }
 
-            if((hyphens == 1 && !isdigit(s[1])) || hyphens == 2)
-                named.push_back(s);
-            else
-                positional.push_back(s);
-        }
+            // Parse `make -j 8` as `make -j=8`
+            if(i + 1 < argc && is_assigned(hyphens, s.substr(hyphens)) && strcmp(argv[i + 1], "--") != 0) {
+                add_token(_token::kind::named, hyphens, s.substr(hyphens), argv[i + 1]);
+                ++i;
+                continue;
+            }
 
-        return std::tuple<std::vector<std::string>, std::vector<std::string>>(named, positional);
-    }
+            if(hyphens > 2 && ! _allow_unused)
+                deferred_assert(identifier(), false, "too many hyphens: " + s.str());
+
+            if(! ((hyphens == 1 && ! shape.negative_number) || hyphens == 2)) {
+                add_token(_token::kind::positional, 0, _string_view(), s);
+                continue;
+            }
 
-    std::vector<std::string> _matcher::expand_single_hyphen(const std::vector<std::string> &named) {
-        std::vector<std::string> new_named;
-        for(const std::string &s: named) {
-            int hyphens = _count_hyphens(s);
-            if(hyphens == 1 && s.find('=') != std::string::npos && s.find('=') >= 3) {
+            size_t eq = shape.eq();
+            if(hyphens == 1 && eq == std::string::npos) { // Expand `-abc` into `-a -b -c`
+                for(size_t j = 1; j < s.size(); ++j)
+                    add_token(_token::kind::flag, 1, s.substr(j, 1), _string_view());
+                continue;
+            }
+
+            if(hyphens == 1 && eq >= 3) {
                 if(! _allow_unused)
                     deferred_assert(identifier(), false,
-                            "expanding single-hyphen arguments can't have value (" + s + ")");
+                            "expanding single-hyphen arguments can't have value (" + s.str() + ")");
                 continue;
             }
 
-            if(hyphens == 1 && s.find('=') == std::string::npos)
-                for(size_t i = 1; i < s.size(); ++i) {
-                    new_named.push_back(std::string("-") + s[i]);
-                }
+            _string_view name = s.substr(hyphens, eq == std::string::npos ? std::string::npos : eq - hyphens);
+            if(hyphens == 2 && name.size() < 2 && ! _allow_unused)
+                deferred_assert(identifier(), false,
+                                "two-hyphen name " + s.substr(0, eq).str() + " must have at least two characters");
+
+            if(eq == std::string::npos)
+                add_token(_token::kind::flag, hyphens, name, _string_view());
             else
-                new_named.push_back(s);
+                add_token(_token::kind::named, hyphens, name, s.substr(eq + 1));
         }
-        return new_named;
+
+        for(; i < argc; ++i)
+            add_token(_token::kind::positional, 0, _string_view(), argv[i]);
     }
 
-    std::vector<std::pair<std::string, optional<std::string>>>
-            _matcher::assign_named_values(const std::vector<std::string> &named) {
-        std::vector<std::pair<std::string, optional<std::string>>> args;
+    size_t _option_table::find_slot(_string_view name) const {
+        size_t mask = _slots.size() - 1;
+        size_t slot = _string_view_hash()(name) & mask;
+        while(_slots[slot] != 0 && _string_view(_long_names[_slots[slot] - 1]) != name)
+            slot = (slot + 1) & mask;
+        return slot;
+    }
 
-        for(const std::string &eq: named) {
-            size_t index = eq.find('=');
-            size_t hyphens = _count_hyphens(eq);
-            std::string name = eq;
-            if(index == std::string::npos) {
-                args.emplace_back(eq, optional<std::string>());
-            } else {
-                name = eq.substr(0, index);
-                std::string value = eq.substr(index + 1);
+    void _option_table::rehash(size_t slots) {
+        _slots.assign(slots, 0);
+        for(size_t i = 0; i < _long_names.size(); ++i)
+            _slots[find_slot(_long_names[i])] = i + 1;
+    }
+
+    void _option_table::add(int hyphens, _string_view name, kind k) {
+        if(hyphens == 1 && name.size() == 1) {
+            kind &current = _short[(unsigned char) name[0]];
+            current = std::max(current, k);
+            return;
+        }
+        if(hyphens != 2)
+            return;
+
+        if(_slots.empty())
+            _slots.assign(16, 0);
+        size_t slot = find_slot(name);
+        if(_slots[slot] != 0) {
+            _long_kinds[_slots[slot] - 1] = std::max(_long_kinds[_slots[slot] - 1], k);
+            return;
+        }
+
+        _long_names.push_back(name.str());
+        _long_kinds.push_back(k);
+        _slots[slot] = _long_names.size();
+        if(_long_names.size() * 2 > _slots.size()) // Keep load factor at most 1/2
+            rehash(_slots.size() * 2);
+    }
+
+    _option_table::kind _option_table::classify(int hyphens, _string_view name) const {
+        if(hyphens == 1 && name.size() == 1)
+            return _short[(unsigned char) name[0]];
+        if(hyphens != 2 || _slots.empty())
+            return kind::unknown;
+
+        size_t index = _slots[find_slot(name)];
+        return index == 0 ? kind::unknown : _long_kinds[index - 1];
+    }
+
+    _arg_shape::_arg_shape(const char *arg): s(arg) {
+        while(hyphens < (int) s.size() && s[hyphens] == '-')
+            ++hyphens;
+        negative_number = hyphens == 1 && s.size() > 1 && s[1] >= '0' && s[1] <= '9';
+    }
+
+    _response_file::~_response_file() {
+#ifdef FIRE_MMAP_ENABLED_
+        if(_mapped) {
+            munmap(_data, _size);
+            return;
+        }
+#endif
+        delete [] _data;
+    }
 
-                args.emplace_back(name, value);
+    bool _response_file::load(const char *path) {
+#ifdef FIRE_MMAP_ENABLED_
+        // A private writable mapping: words are rewritten in place without touching the file
+        int fd = open(path, O_RDONLY);
+        if(fd < 0)
+            return false;
+        struct stat st;
+        bool ok = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+        if(ok && st.st_size > 0) {
+            void *data = mmap(nullptr, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            ok = data != MAP_FAILED;
+            if(ok) {
+                _data = (char *) data;
+                _size = (size_t) st.st_size;
+                _mapped = true;
             }
-            if(! _allow_unused) {
-                size_t name_size = eq.size() - hyphens;
-                deferred_assert(identifier(), hyphens <= 2,
-                                name + " must have at most two hyphens");
-                if (hyphens == 2)
-                    deferred_assert(identifier(), name_size >= 2,
-                                    "multi-character name " + name + " must have at least two hyphens");
+        }
+        close(fd);
+        return ok;
+#else
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if(! file.is_open())
+            return false;
+        _size = (size_t) file.tellg();
+        _data = new char[_size + 1];
+        file.seekg(0);
+        return (bool) file.read(_data, (std::streamsize) _size);
+#endif
+    }
+
+    std::string _response_files::expand(int argc, const char **argv, const _option_table &options) {
+        _files.clear();
+        _copies.clear();
+        _argv.clear();
+        _options = &options;
+        _positional_only = false;
+        _value_next = false;
+
+        std::string error;
+        if(argc > 0)
+            _argv.push_back(argv[0]);
+        for(int i = 1; i < argc && error.empty(); ++i)
+            error = add(argv[i], 0);
+        _argv.push_back(nullptr);
+        return error;
+    }
+
+    std::string _response_files::add(const char *arg, int depth) {
+        if(_positional_only || _value_next || ! is_file(arg)) {
+            // Same as _matcher::tokenize(): `--` is never a value, `-j 8`/`--name value` take the next argument
+            _arg_shape shape(arg);
+            _positional_only = _positional_only || shape.s == "--";
+            _value_next = ! _positional_only && ! _value_next &&
+                          _options->classify(shape.hyphens, shape.s.substr((size_t) shape.hyphens)) == _option_table::kind::valued;
+            _argv.push_back(arg);
+            return "";
+        }
+
+        const char *path = arg + 1;
+        if(depth == max_depth)
+            return "response files nested more than " + std::to_string(max_depth) + " levels deep at " + arg;
+        std::unique_ptr<_response_file> file(new _response_file());
+        if(! file->load(path))
+            return std::string("can't read response file ") + path;
+
+        // Words are compacted towards the start of the file, each followed by '\0'
+        struct in_place_words {
+            char *write, *end, *start;
+            std::deque<std::string> &copies;
+            std::vector<const char *> words;
+
+            void begin_word() { start = write; }
+            void push(char c) { *write++ = c; }
+            void end_word() {
+                if(write < end) {
+                    *write++ = '\0';
+                    words.push_back(start);
+                } else {
+                    copies.emplace_back(start, write);
+                    words.push_back(copies.back().c_str());
+                }
             }
+        } out{file->data(), file->data() + file->size(), nullptr, _copies, {}};
+        bool ok = _split_shell_words(_string_view(file->data(), file->size()), out);
+        _files.push_back(std::move(file));
+        if(! ok)
+            return std::string("unterminated quote in response file ") + path;
+
+        for(const char *word: out.words) {
+            std::string error = add(word, depth + 1);
+            if(! error.empty())
+                return error;
+        }
+        return "";
+    }
+
+    void _matcher::add_token(_token::kind k, int hyphens, _string_view name, _string_view value) {
+        if(k == _token::kind::positional)
+            _positional.push_back(_tokens.size());
+        _tokens.push_back({k, hyphens, name, value});
+    }
+
+    void _matcher::index_tokens() {
+        _short_index.clear();
+        _long_index.clear();
+        _short_index.reserve(_tokens.size() - _positional.size());
+        _long_index.reserve(_tokens.size() - _positional.size());
+        _used.assign(_tokens.size(), false);
+
+        for(size_t i = 0; i < _tokens.size(); ++i) {
+            const _token &t = _tokens[i];
+            if(t.k == _token::kind::positional)
+                continue;
+            auto &index = t.hyphens == 1 ? _short_index : _long_index;
+            if(! index.emplace(t.name, i).second)
+                deferred_assert(identifier(), false, "multiple occurrences of argument " + t.name_with_hyphens());
         }
-        return args;
     }
 
-    bool _matcher::deferred_assert(const identifier &id, bool pass, const std::string &msg) {
+    bool _matcher::deferred_assert(const identifier &id, bool pass, _string_view msg) {
         if(! _strict) {
-            input_assert(pass, msg);
+            _instant_assert(pass, msg, false);
             return pass;
         }
         if(! pass)
-            _deferred_error.set(id, msg);
+            _deferred_error.set(id, msg.str());
         return pass;
     }
 
     optional<std::string> _matcher::match_named(const identifier &id) const {
-        for(const auto &p: _named) {
-            const std::string &name = p.first;
-            if(id.contains(name))
-                return name;
-        }
+        size_t index = find_named(id);
+        if(index < _tokens.size())
+            return _tokens[index].name_with_hyphens();
         return optional<std::string>();
     }
 
 
-    std::string _arg_logger::_make_printable(const identifier &id, const elem &elem, bool verbose) {
-        std::string printable;
-        if(elem.optional) printable += "[";
-        printable += verbose ? id.help() : id.longer();
+    std::string _arg_logger::elem::default_str() const {
+        return has_def_string ? def_string : def_number.str();
+    }
+
+    void _arg_logger::_append_printable(std::string &out, const identifier &id, const elem &elem, bool verbose) const {
+        if(elem.optional) out += '[';
+        if(verbose)
+            id.append_help(out);
+        else
+            id.append_longer(out);
         if(elem.t != elem::type::none && ! (! verbose && id.get_pos().has_value())) {
-            printable += id.get_pos().has_value() ? " " : "=";
+            out += id.get_pos().has_value() ? ' ' : '=';
             if(elem.t == elem::type::string)
-                printable += "STRING";
+                out += "STRING";
             if(elem.t == elem::type::integer)
-                printable += "INTEGER";
+                out += "INTEGER";
             if(elem.t == elem::type::real)
-                printable += "REAL NUMBER";
+                out += "REAL NUMBER";
         }
-        if(elem.optional) printable += "]";
-        return printable;
+        if(elem.optional) out += ']';
     }
 
-    void _arg_logger::_add_to_help(std::string &usage, std::string &options,
-                                    const identifier &id, const elem &elem, size_t margin) {
-        usage += " ";
-        usage += _make_printable(id, elem, false);
-
-        std::string printable = _make_printable(id, elem, true);
-        options += "  " + printable + std::string(2 + margin - printable.size(), ' ') + elem.descr;
-        if(! elem.def.empty())
-            options += " [default: " + elem.def + "]";
-        options += "\n";
+    void _arg_logger::_append_description(std::string &out, const identifier &id, const elem &elem) const {
+        const std::string &descr = id.get_descr();
+        out += descr;
+        std::string constraints = elem.constraints.help(id);
+        if(! constraints.empty()) {
+            if(! descr.empty()) out += ' ';
+            out += constraints;
+        }
+        if(elem.has_default())
+            out.append(" [default: ").append(elem.default_str()).append("]");
     }
 
-    void _arg_logger::print_help() {
-        using id2elem = std::pair<identifier, elem>;
+    std::string _arg_logger::help_text(_string_view filter) const {
+        // Thousands of arguments are possible: each is formatted once into a shared buffer, ranked by name once,
+        // sorted by integer keys and written out with a single call
+        struct row {
+            identifier::type type;
+            int optional, name_rank, pos; // Sort key after type, orders the same way as identifier::operator<
+            size_t usage, printable, descr, end; // Offsets of '\n' separated fields in text
+        };
 
-        std::string usage = "Usage:\n  " + _::matcher.get_executable();
-        std::string options;
+        std::string text;
+        text.reserve(_params.size() * 96);
+        std::vector<row> rows(_params.size());
+        std::vector<std::pair<const std::string *, row *>> by_name;
+        by_name.reserve(_params.size());
+        for(size_t i = 0; i < _params.size(); ++i) {
+            const elem &e = _params[i].second;
+            identifier id = _params[i].first;
+            id.set_optional(e.optional);
+            if(e.t == elem::type::none)
+                id.set_as_flag();
+
+            row &r = rows[i];
+            r.type = id.get_type();
+            r.optional = ! id.sort_key().empty() && e.optional; // Optionality is only compared between named arguments
+            r.pos = id.get_pos().value_or(1000000);
+            r.usage = text.size();
+            _append_printable(text, id, e, false);
+            r.printable = text.size() + 1;
+            text += '\n';
+            _append_printable(text, id, e, true);
+            r.descr = text.size() + 1;
+            text += '\n';
+            _append_description(text, id, e);
+            r.end = text.size();
+            text += '\n';
+            by_name.emplace_back(&_params[i].first.sort_key(), &r);
+        }
 
-        std::vector<id2elem> printed(_params);
-        for(id2elem &e: printed) {
-            e.first.set_optional(e.second.optional);
-            if(e.second.t == elem::type::none)
-                e.first.set_as_flag();
+        // Names are ranked once, rows then compare ranks instead of strings
+        std::sort(by_name.begin(), by_name.end(), [](const std::pair<const std::string *, row *> &a,
+                                                     const std::pair<const std::string *, row *> &b) { return *a.first < *b.first; });
+        for(size_t i = 0; i < by_name.size(); ++i)
+            by_name[i].second->name_rank = i > 0 && *by_name[i].first == *by_name[i - 1].first ? by_name[i - 1].second->name_rank : (int) i;
+
+        std::vector<const row *> order;
+        order.reserve(rows.size());
+        for(const row &r: rows)
+            order.push_back(&r);
+
+        // Only names and descriptions given by the programmer are searched, not the generated types, defaults or constraints.
+        // They're copied in lowercase into one search index, each hit is mapped to its row by offset
+        if(! filter.empty()) {
+            std::string index, needle = filter.str();
+            std::vector<size_t> starts; // Offset of each row's entry in index
+            starts.reserve(_params.size());
+            for(const std::pair<identifier, elem> &p: _params) {
+                const identifier &id = p.first;
+                starts.push_back(index.size());
+                if(! id.plain_short().empty())
+                    index.append("-").append(id.plain_short()).append("\n");
+                if(! id.plain_long().empty())
+                    index.append("--").append(id.plain_long()).append("\n");
+                index.append(id.positional_name()).append("\n");
+                index.append(id.get_descr()).append("\n");
+            }
+            for(std::string *str: {&index, &needle})
+                std::transform(str->begin(), str->end(), str->begin(), [](char c){ return (char) tolower(c); });
+
+            order.clear();
+            for(size_t found = index.find(needle); found != std::string::npos; ) {
+                size_t i = (size_t) (std::upper_bound(starts.begin(), starts.end(), found) - starts.begin()) - 1;
+                order.push_back(&rows[i]);
+                found = i + 1 < starts.size() ? index.find(needle, starts[i + 1]) : std::string::npos;
+            }
         }
 
-        std::sort(printed.begin(), printed.end(), [](const id2elem &a, const id2elem &b) {
-            return a.first < b.first;
+        std::sort(order.begin(), order.end(), [](const row *a, const row *b) {
+            if(a->type != b->type) return (int) a->type < (int) b->type;
+            if(a->optional != b->optional) return a->optional < b->optional;
+            if(a->name_rank != b->name_rank) return a->name_rank < b->name_rank;
+            return a->pos < b->pos;
         });
 
-        size_t margin = 0;
-        for(const auto& it: printed)
-            margin = std::max(margin, _make_printable(it.first, it.second, true).size());
-
-        identifier::type prev_type = identifier::type::not_specified;
-        for(const auto& it: printed) {
-            identifier::type cur_type = it.first.get_type();
-            if (cur_type != prev_type) {
-                prev_type = cur_type;
-
-                std::string separator;
-                if (cur_type == identifier::type::positional) separator = "Positional arguments";
-                if (cur_type == identifier::type::named) separator = "Named arguments";
-                if (cur_type == identifier::type::flag) separator = "Flags";
-                options += "\n" + separator + ":\n";
-            }
-            _add_to_help(usage, options, it.first, it.second, margin);
+        size_t margin = 0, size = 64 + _::matcher().get_executable().size() + 2 * _program_descr.size() + filter.size();
+        for(const row *r: order) {
+            margin = std::max(margin, r->descr - 1 - r->printable);
+            size += r->end - r->usage + 6;
         }
+        size += order.size() * margin;
+
+        std::string out;
+        out.reserve(size);
+        out += "\nUsage:\n  ";
+        out += _::matcher().get_executable();
+        for(const row *r: order)
+            out.append(" ").append(text, r->usage, r->printable - 1 - r->usage);
 
-        std::string program_descr;
         if(! _program_descr.empty())
-            program_descr = "\n\nDescription:" + _replace_all("\n" + _program_descr, "\n", "\n  ");
+            out += "\n\nDescription:" + _replace_all("\n" + _program_descr, "\n", "\n  ");
+        out += "\n\n";
 
-        std::cerr << "\n" << usage;
-        std::cerr << program_descr << "\n\n";
-        std::cerr << options << "\n";
+        if(! filter.empty() && order.empty())
+            out.append("\nNo arguments match \"").append(filter.data(), filter.size()).append("\"\n");
+
+        identifier::type prev_type = identifier::type::not_specified;
+        for(const row *r: order) {
+            if(r->type != prev_type) {
+                prev_type = r->type;
+                if(r->type == identifier::type::positional) out += "\nPositional arguments:\n";
+                if(r->type == identifier::type::named) out += "\nNamed arguments:\n";
+                if(r->type == identifier::type::flag) out += "\nFlags:\n";
+            }
+            size_t printable = r->descr - 1 - r->printable;
+            out.append("  ").append(text, r->printable, printable).append(2 + margin - printable, ' ');
+            out.append(text, r->descr, r->end - r->descr).append("\n");
+        }
+        out += '\n';
 #ifndef FIRE_EXCEPTIONS_ENABLED_
-        for(const auto& it: printed) {
-            identifier::type cur_type = it.first.get_type();
-            if(cur_type == identifier::type::named) {
-                std::string name = it.first.longer();
-                std::cerr << "\nNotes:\n";
-                std::cerr << "  All named arguments must be supplied as an equation.\n"
-                          << "  Eg. `./program " << name << "=VALUE`, not `./program " << name << " VALUE`\n\n" << std::flush;
+        for(const row *r: order) {
+            if(r->type == identifier::type::named) {
+                std::string name = _params[(size_t) (r - rows.data())].first.longer();
+                out += "\nNotes:\n";
+                out += "  All named arguments must be supplied as an equation.\n";
+                out += "  Eg. `./program " + name + "=VALUE`, not `./program " + name + " VALUE`\n\n";
                 break;
             }
         }
 #endif
+        return out;
     }
 
-    std::vector<std::string> _arg_logger::get_assignment_arguments() const {
-        // Returns arguments expecting a value
-
-        std::vector<std::string> args;
-        for(const std::pair<identifier, elem> &p: _params)
-            if(p.second.t != elem::type::none) {
-                optional<std::string> short_name = p.first.short_name();
-                if(short_name.has_value())
-                    args.push_back(short_name.value());
+    void _arg_logger::print_help(_string_view filter) {
+        std::string out = help_text(filter);
+        std::cerr.write(out.data(), (std::streamsize) out.size());
+        std::cerr.flush();
+    }
 
-                optional<std::string> long_name = p.first.long_name();
-                if(long_name.has_value())
-                    args.push_back(long_name.value());
-            }
+    _option_table _arg_logger::compile_options() const {
+        _option_table options;
+        for(const std::pair<identifier, elem> &p: _params) {
+            _option_table::kind k = p.second.t == elem::type::none ? _option_table::kind::flag : _option_table::kind::valued;
+            if(! p.first.plain_short().empty())
+                options.add(1, p.first.plain_short(), k);
+            if(! p.first.plain_long().empty())
+                options.add(2, p.first.plain_long(), k);
+        }
+        return options;
+    }
 
-        return args;
+    const _option_table& _arg_logger::options() {
+        if(! _options_current) {
+            _options = compile_options();
+            _options_current = true;
+        }
+        return _options;
     }
 
     void _arg_logger::log(const identifier &name, const elem &_elem) {
+        if(_frozen)
+            return;
+        _options_current = false;
         elem elem = _elem;
-        elem.optional |= ! elem.def.empty();
+        elem.optional |= elem.has_default();
         _params.emplace_back(name, elem);
     }
 
     void _arg_logger::set_introspect_count(int count) {
         _introspect_count = count;
-        _::matcher.set_introspect(_introspect_count > 0);
+        _::matcher().set_introspect(_introspect_count > 0);
     }
 
     int _arg_logger::decrease_introspect_count() {
         --_introspect_count;
-        _::matcher.set_introspect(_introspect_count > 0);
+        _::matcher().set_introspect(_introspect_count > 0);
         return _introspect_count;
     }
 
@@ -1032,302 +2212,581 @@ namespace fire {
     }
 
     inline void print_help() {
-        _::logger.print_help();
+        _::logger().print_help();
     }
 
+    inline void free_parser_memory() {
+        _::matcher() = _matcher();
+        if(! _::logger().frozen()) // A fire::program keeps its declarations for the next command line
+            _::logger() = _arg_logger();
+    }
 
-    template<typename T>
-    void _bound<T>::check_constraint(const identifier &id, long long val) const {
-        if(std::is_floating_point<T>::value)
-            _constraint::check_constraint(id, val);
-        if(upper) input_assert(val <= bound, "argument " + helpful_name(id) + " value " + std::to_string(val) + " must be at most " + std::to_string(bound));
-        else input_assert(val >= bound, "argument " + helpful_name(id) + " value " + std::to_string(val) + " must be at least " + std::to_string(bound));
+
+    template <typename V>
+    inline bool _bound::less_than(V val) const {
+        switch(_kind) {
+            case kind::signed_t: return _less(_ll, val);
+            case kind::unsigned_t: return _less(_ull, val);
+            case kind::floating_t: return _less(_ld, val);
+            default: return false;
+        }
     }
 
-    template<typename T>
-    void _bound<T>::check_constraint(const identifier &id, long double val) const {
-        if(upper) input_assert(val <= bound, "argument " + helpful_name(id) + " value " + std::to_string(val) + " must be at most " + std::to_string(bound));
-        else input_assert(val >= bound, "argument " + helpful_name(id) + " value " + std::to_string(val) + " must be at least " + std::to_string(bound));
+    template <typename V>
+    inline bool _bound::greater_than(V val) const {
+        switch(_kind) {
+            case kind::signed_t: return _less(val, _ll);
+            case kind::unsigned_t: return _less(val, _ull);
+            case kind::floating_t: return _less(val, _ld);
+            default: return false;
+        }
+    }
+
+    inline bool _bound::less_than(const _bound &other) const {
+        switch(other._kind) {
+            case kind::signed_t: return less_than(other._ll);
+            case kind::unsigned_t: return less_than(other._ull);
+            case kind::floating_t: return less_than(other._ld);
+            default: return false;
+        }
+    }
+
+    inline std::string _bound::str() const {
+        switch(_kind) {
+            case kind::signed_t: return std::to_string(_ll);
+            case kind::unsigned_t: return std::to_string(_ull);
+            case kind::floating_t: return std::to_string(_ld);
+            default: return "";
+        }
+    }
+
+    template <typename T>
+    inline void _print_values(std::ostream &os, const std::vector<T> &values) {
+        for(size_t i = 0; i < values.size(); ++i)
+            os << (i == 0 ? "" : ", ") << values[i];
+    }
+
+    inline std::string _one_of::help() const {
+        std::stringstream descr;
+        descr << "[Possible values: (";
+        _print_values(descr, ll_values);
+        _print_values(descr, ull_values);
+        _print_values(descr, ld_values);
+        _print_values(descr, s_values);
+        descr << ")]";
+        return descr.str();
     }
 
 
     template<typename T1, typename T2>
-    inline void _one_of::check_constraint_template(const identifier &id, const std::string &type_name, const std::vector<T1> &values, T2 cur_val) const {
-        _api_assert(! values.empty(), "converting " + helpful_name(id) + " to " + type_name + ", but values specified in one_of() are not " + type_name + "s");
+    inline void _one_of::check_constraint_template(const identifier &id, const std::string &type_name,
+                                                   const std::vector<T1> &values, const std::vector<T1> &sorted, T2 cur_val) const {
+        if(_previous)
+            _previous->check_constraint(id, cur_val);
+
+        _api_assert(! values.empty(), [&]{ return "converting " + helpful_name(id) + " to " + type_name + ", but values specified in one_of() are not " + type_name + "s"; });
+
+        _argument_assert(id, _sorted_contains(sorted, cur_val), [&]{
+            std::stringstream msg;
+            msg << "argument " << helpful_name(id) << " value must be one of (";
+            for(size_t i = 0; i < values.size(); ++i)
+                msg << (i > 0 ? ", " : "") << values[i];
+            msg << "), but given was `" << cur_val << "`";
+            return msg.str();
+        });
+    }
 
-        bool success = false;
-        std::stringstream lst;
-        lst << "(";
-        for(size_t i = 0; i < values.size(); ++i) {
-            if(values[i] == cur_val)
-                success = true;
-            if(i > 0)
-                lst << ", ";
-            lst << values[i];
-        }
-        lst << ")";
+    template<typename T2>
+    inline void _one_of::check_integral(const identifier &id, const std::string &type_name, T2 cur_val) const {
+        // Signed and unsigned values are compared by value (_less), not converted
+        if(! ull_values.empty())
+            check_constraint_template<unsigned long long, T2>(id, type_name, ull_values, ull_sorted, cur_val);
+        else
+            check_constraint_template<long long, T2>(id, type_name, ll_values, ll_sorted, cur_val);
+    }
+
+    inline void _one_of::check_constraint(const identifier &id, long long val) const {
+        check_integral(id, "integer", val);
+    }
 
-        std::stringstream cur_val_str;
-        cur_val_str << cur_val;
-        input_assert(success, "argument " + helpful_name(id) + " value must be one of " + lst.str() + ", but given was `" + cur_val_str.str() + "`");
+    inline void _one_of::check_constraint(const identifier &id, unsigned long long val) const {
+        check_integral(id, "integer", val);
     }
 
     inline void _one_of::check_constraint(const identifier &id, long double val) const {
         if(!ld_values.empty())
-            check_constraint_template<long double, long double>(id, "real number", ld_values, val);
+            check_constraint_template<long double, long double>(id, "real number", ld_values, ld_sorted, val);
         else
-            check_constraint_template<long long, long double>(id, "real number", ll_values, val);
+            check_integral(id, "real number", val);
     }
 
-
-    template<typename T>
-    inline void arg::_check_constraints(T value) const {
-        for(const std::unique_ptr<_constraint> &c: _constraints)
-            c->check_constraint(_id, value);
+    inline void _one_of::check_constraint(const identifier &id, const std::string &val) const {
+        check_constraint_template<std::string, const std::string &>(id, "string", s_values, s_sorted, val);
     }
 
-    template <>
-    inline optional<long long> arg::_get<long long>() {
-        auto elem = _::matcher.get_and_mark_as_queried(_id);
-        _::matcher.deferred_assert(_id, elem.second != _matcher::arg_type::bool_t,
-                                   "argument " + helpful_name(_id) + " must have value");
-        if(elem.second == _matcher::arg_type::string_t) {
-            char *end_ptr;
-            errno = 0;
-            long long converted = std::strtoll(elem.first.data(), &end_ptr, 10);
-
-            if(errno == ERANGE)
-                _::matcher.deferred_assert(_id, false, "parameter " + helpful_name(_id) + " value " + elem.first + " out of range");
 
-            _::matcher.deferred_assert(_id, end_ptr == elem.first.data() + elem.first.size(),
-                                       "parameter " + helpful_name(_id) + " value " + elem.first + " is not an integer");
+    inline void _constraint_set::add_bound(const _bound &bound, bool upper) {
+        if(bound.get_kind() == _bound::kind::floating_t)
+            _floating_bound = true;
 
-            return converted;
-        }
+        _bound &current = upper ? _upper : _lower;
+        if(current.get_kind() == _bound::kind::none || (upper ? bound.less_than(current) : current.less_than(bound)))
+            current = bound;
+    }
 
-        return _int_value;
+    inline void _constraint_set::add_one_of(_one_of values) {
+        values._previous = std::move(_one_of_values);
+        _one_of_values = std::make_shared<const _one_of>(std::move(values));
     }
 
-    template <>
-    inline optional<long double> arg::_get<long double>() {
-        auto elem = _::matcher.get_and_mark_as_queried(_id);
-        _::matcher.deferred_assert(_id, elem.second != _matcher::arg_type::bool_t,
-                                   "argument " + helpful_name(_id) + " must have a value");
-        if(elem.second == _matcher::arg_type::string_t) {
-            char *end_ptr;
-            errno = 0;
-            long double converted = std::strtold(elem.first.data(), &end_ptr);
+    template <typename V>
+    inline void _constraint_set::check_bound(const identifier &id, const _bound &bound, bool upper, V val) const {
+        if(bound.get_kind() == _bound::kind::none)
+            return;
+        _argument_assert(id, upper ? ! bound.less_than(val) : ! bound.greater_than(val), [&]{
+            return "argument " + helpful_name(id) + " value " + std::to_string(val) + " must be at " + (upper ? "most " : "least ") + bound.str();
+        });
+    }
 
-            if(errno == ERANGE)
-                _::matcher.deferred_assert(_id, false, "parameter " + helpful_name(_id) + " value " + elem.first + " out of range");
+    template <typename V, typename std::enable_if<std::is_arithmetic<V>::value>::type*>
+    inline void _constraint_set::check_constraints(const identifier &id, V val) const {
+        _api_assert(! (std::is_integral<V>::value && _floating_bound), "Constraint applied to wrong type argument (integral type)");
+        check_bound(id, _lower, false, val);
+        check_bound(id, _upper, true, val);
+        if(_one_of_values)
+            _one_of_values->check_constraint(id, val);
+    }
 
-            _::matcher.deferred_assert(_id, end_ptr == elem.first.data() + elem.first.size(),
-                                       "parameter " + helpful_name(_id) + " value " + elem.first + " is not a real number");
+    inline void _constraint_set::check_constraints(const identifier &id, const std::string &val) const {
+        _api_assert(_lower.get_kind() == _bound::kind::none && _upper.get_kind() == _bound::kind::none,
+                    "Constraint applied to wrong type argument (string type)");
+        if(_one_of_values)
+            _one_of_values->check_constraint(id, val);
+    }
 
-            return converted;
+    inline std::string _constraint_set::help(const identifier &id) const {
+        std::string descr;
+        bool lower = _lower.get_kind() != _bound::kind::none, upper = _upper.get_kind() != _bound::kind::none;
+        if(lower || upper)
+            descr = "[" + (lower ? _lower.str() + " <= " : "") + _without_hyphens(id.longer()) + (upper ? " <= " + _upper.str() : "") + "]";
+
+        std::vector<const _one_of *> chain; // Newest first
+        for(const _one_of *values = _one_of_values.get(); values != nullptr; values = values->_previous.get())
+            chain.push_back(values);
+        for(auto it = chain.rbegin(); it != chain.rend(); ++it) {
+            if(! descr.empty())
+                descr += ' ';
+            descr += (*it)->help();
         }
+        return descr;
+    }
 
-        if(_float_value.has_value()) return _float_value;
-        if(_int_value.has_value()) return (long double) _int_value.value();
-        return {};
+
+    template<typename T>
+    inline void arg::_check_constraints(const T &value) const {
+        // Values are widened exactly, so constraints compare the same way as they would in T
+        using wide_t = typename std::conditional<std::is_floating_point<T>::value, long double,
+                       typename std::conditional<std::is_signed<T>::value, long long,
+                       typename std::conditional<std::is_integral<T>::value, unsigned long long, const T &>::type>::type>::type;
+        _constraints.check_constraints(_id, (wide_t) value);
     }
 
     template <>
-    inline optional<std::string> arg::_get<std::string>() {
-        auto elem = _::matcher.get_and_mark_as_queried(_id);
-        _::matcher.deferred_assert(_id, elem.second != _matcher::arg_type::bool_t,
-                                   "argument " + helpful_name(_id) + " must have a value");
+    inline optional<std::string> arg::_get<std::string>(const _queried_value &elem) {
+        _::matcher().deferred_assert(_id, elem.second != _matcher::arg_type::bool_t,
+                                   [this]{ return "argument " + helpful_name(_id) + " must have a value"; });
 
         if(elem.second == _matcher::arg_type::string_t) {
-            _check_constraints(elem.first);
-            return elem.first;
+            std::string value = elem.first.str();
+            _check_constraints(value);
+            return value;
         }
 
         return _string_value;
     }
 
     template <typename T, typename std::enable_if<std::is_integral<T>::value && ! std::is_same<T, bool>::value>::type*>
-    optional<T> arg::_get_with_precision() {
-        optional<long long> opt_value = _get<long long>();
-        if(! opt_value.has_value())
-            return optional<T>();
-        long long value = opt_value.value();
-        _check_constraints(value);
+    optional<T> arg::_get_with_precision(const _queried_value &elem) {
+        _::matcher().deferred_assert(_id, elem.second != _matcher::arg_type::bool_t,
+                                   [this]{ return "argument " + helpful_name(_id) + " must have value"; });
 
         bool is_signed = std::numeric_limits<T>::is_signed;
         T mn = std::numeric_limits<T>::lowest();
         T mx = std::numeric_limits<T>::max();
 
-        _::matcher.deferred_assert(_id, is_signed || value >= 0,
-                                   "argument " + helpful_name(_id) + " value " + std::to_string(value) + " must be positive");
-        _::matcher.deferred_assert(_id, mn <= value && value <= mx,
-                                   "argument " + helpful_name(_id) + " value " + std::to_string(value) + " out of range [" + std::to_string(mn) + ", " + std::to_string(mx) + "]");
+        T value = 0;
+        if(elem.second == _matcher::arg_type::string_t) {
+            _parse_result result = _from_chars(elem.first, value);
+            _::matcher().deferred_assert(_id, result != _parse_result::invalid,
+                                       [&]{ return "parameter " + helpful_name(_id) + " value " + elem.first.str() + " is not an integer"; });
+            _::matcher().deferred_assert(_id, result != _parse_result::out_of_range, [&]{
+                if(! is_signed && elem.first[0] == '-')
+                    return "argument " + helpful_name(_id) + " value " + elem.first.str() + " must be positive";
+                return "argument " + helpful_name(_id) + " value " + elem.first.str() + " out of range [" + std::to_string(mn) + ", " + std::to_string(mx) + "]";
+            });
+            if(result != _parse_result::ok)
+                return value;
+        } else if(_int_value.has_value()) {
+            long long def = _int_value.value();
+            _::matcher().deferred_assert(_id, is_signed || def >= 0,
+                                       [&]{ return "argument " + helpful_name(_id) + " value " + std::to_string(def) + " must be positive"; });
+            _::matcher().deferred_assert(_id, ! _less(def, mn) && ! _less(mx, def),
+                                       [&]{ return "argument " + helpful_name(_id) + " value " + std::to_string(def) + " out of range [" + std::to_string(mn) + ", " + std::to_string(mx) + "]"; });
+            value = (T) def;
+        } else
+            return optional<T>();
 
-        return (T) value;
+        _check_constraints(value);
+        return value;
     }
 
     template <typename T, typename std::enable_if<std::is_floating_point<T>::value>::type*>
-    optional<T> arg::_get_with_precision() {
-        optional<long double> opt_value = _get<long double>();
-        if(! opt_value.has_value())
-            return optional<T>();
-        long double value = opt_value.value();
-        _check_constraints(value);
-
-        T min = std::numeric_limits<T>::lowest();
-        T max = std::numeric_limits<T>::max();
+    optional<T> arg::_get_with_precision(const _queried_value &elem) {
+        _::matcher().deferred_assert(_id, elem.second != _matcher::arg_type::bool_t,
+                                   [this]{ return "argument " + helpful_name(_id) + " must have a value"; });
 
-        _::matcher.deferred_assert(_id, min <= value && value <= max,
-                                   "argument " + helpful_name(_id) + " value " + std::to_string(value) + " out of range");
+        T value = 0;
+        if(elem.second == _matcher::arg_type::string_t) {
+            _parse_result result = _from_chars(elem.first, value);
+            _::matcher().deferred_assert(_id, result != _parse_result::invalid,
+                                       [&]{ return "parameter " + helpful_name(_id) + " value " + elem.first.str() + " is not a real number"; });
+            _::matcher().deferred_assert(_id, result != _parse_result::out_of_range,
+                                       [&]{ return "parameter " + helpful_name(_id) + " value " + elem.first.str() + " out of range"; });
+            if(result != _parse_result::ok)
+                return value;
+        } else if(_float_value.has_value() || _int_value.has_value()) {
+            long double def = _float_value.has_value() ? _float_value.value() : (long double) _int_value.value();
+            T min = std::numeric_limits<T>::lowest();
+            T max = std::numeric_limits<T>::max();
+            _::matcher().deferred_assert(_id, min <= def && def <= max,
+                                       [&]{ return "argument " + helpful_name(_id) + " value " + std::to_string(def) + " out of range"; });
+            value = (T) def;
+        } else
+            return optional<T>();
 
-        return (T) value;
+        _check_constraints(value);
+        return value;
     }
 
     template <typename T>
     optional<T> arg::_convert_optional(bool dec_main_args) {
-        if(_::matcher.get_introspect())
+        if(_::matcher().get_introspect())
             return optional<T>();
 
         _api_assert(!(_int_value.has_value() || _float_value.has_value() || _string_value.has_value()),
                     "optional argument has default value");
-        optional<T> val = _get_with_precision<T>();
-        _::matcher.check(dec_main_args);
+        optional<T> val = _get_with_precision<T>(_::matcher().get_and_mark_as_queried(_id));
+        _::matcher().check(dec_main_args);
         return val;
     }
 
     template <typename T>
     T arg::_convert(bool dec_main_args) {
-        if(_::matcher.get_introspect())
+        if(_::matcher().get_introspect())
             return T();
 
-        optional<T> val = _get_with_precision<T>();
-        _::matcher.deferred_assert(_id, val.has_value(),
-                                   "required argument " + _id.longer() + " not provided");
-        _::matcher.check(dec_main_args);
-        return val.value_or(T());
+        optional<T> val = _get_with_precision<T>(_::matcher().get_and_mark_as_queried(_id));
+        _::matcher().deferred_assert(_id, val.has_value(),
+                                   [this]{ return "required argument " + _id.longer() + " not provided"; });
+        _::matcher().check(dec_main_args);
+        return std::move(val).value_or(T());
     }
 
     void arg::_log(_arg_logger::elem::type t, bool optional) {
-        std::string def;
-        if(_int_value.has_value()) def = std::to_string(_int_value.value());
-        if(_float_value.has_value()) def = std::to_string(_float_value.value());
-        if(_string_value.has_value()) def = _string_value.value();
+        if(! _::logger().frozen()) {
+            _bound def_number;
+            if(_int_value.has_value()) def_number = _bound(_int_value.value());
+            if(_float_value.has_value()) def_number = _bound(_float_value.value());
 
-        _::logger.log(_id, {_id.get_descr(), t, def, optional});
+            _::logger().log(_id, {t, optional, def_number, _string_value.has_value(), _string_value.value_or(""), _constraints});
+        }
 
-        int count = _::logger.get_introspect_count();
+        int count = _::logger().get_introspect_count();
         if(count > 0) { // introspection is active
-            count = _::logger.decrease_introspect_count();
-            if(count == 0) { // introspection ends
-#ifdef FIRE_EXCEPTIONS_ENABLED_
-                throw _escape_exception();
-#endif
-            }
+            count = _::logger().decrease_introspect_count();
+            if(count == 0) // introspection ends
+                _escape();
         }
     }
 
-    inline arg& arg::operator=(const arg &other) {
-        _id = other._id;
-        _int_value = other._int_value;
-        _float_value = other._float_value;
-        _string_value = other._string_value;
-
-        _constraints.clear();
-        for(const std::unique_ptr<_constraint> &c: other._constraints)
-            _constraints.push_back(c->clone());
-
-        return *this;
-    }
-
     arg::operator bool() {
         _api_assert(!_int_value.has_value() && !_float_value.has_value() && !_string_value.has_value(),
-                    _id.longer() + " flag parameter must not have default value");
+                    [this]{ return _id.longer() + " flag parameter must not have default value"; });
 
         _log(_arg_logger::elem::type::none, true); // User sees this as flag, not boolean option
-        auto elem = _::matcher.get_and_mark_as_queried(_id);
-        _::matcher.deferred_assert(_id, elem.second != _matcher::arg_type::string_t,
-                                   "flag " + helpful_name(_id) + " must not have value");
-        _::matcher.check(true);
+        auto elem = _::matcher().get_and_mark_as_queried(_id);
+        _::matcher().deferred_assert(_id, elem.second != _matcher::arg_type::string_t,
+                                   [this]{ return "flag " + helpful_name(_id) + " must not have value"; });
+        _::matcher().check(true);
         return elem.second == _matcher::arg_type::bool_t;
     }
 
     template <typename T>
     arg::operator std::vector<T>() {
         std::vector<T> ret;
-        for(size_t i = 0; i < _::matcher.pos_args(); ++i)
-            ret.push_back(arg((int) i)._convert<T>(false));
+        if(! _::matcher().get_introspect()) {
+            size_t count = _::matcher().get_and_mark_variadic_as_queried();
+            ret.reserve(count);
+
+            arg element; // Reused for all positional arguments, only its identifier's position changes
+            for(size_t i = 0; i < count; ++i) {
+                element._id.set_pos((int) i); // Only read when an error message is built
+                _queried_value elem(_::matcher().get_positional(i), _matcher::arg_type::string_t);
+                ret.push_back(element._get_with_precision<T>(elem).value_or(T()));
+            }
+        }
         _log(_arg_logger::elem::type::none, true);
-        _::matcher.check(true);
+        _::matcher().check(true);
         return ret;
     }
 
+    template <typename T, typename std::enable_if<! std::is_arithmetic<T>::value>::type*>
+    inline void arg::_add_bound(T, bool, const char *caller) {
+        _api_assert(false, [&]{ return std::string("called ") + caller + " with improper argument (not integral or floating point type)"; });
+    }
+
     template <typename T>
-    arg arg::min(T mn) const {
-        arg ret = *this;
-        ret._id.append_descr("[" + std::to_string(mn) + " <= " + _without_hyphens(_id.longer()) + "]");
-        if(std::is_integral<T>::value)
-            ret._constraints.push_back(std::unique_ptr<_constraint>((_constraint *) (new _bound<long long>(mn, false))));
-        else if(std::is_floating_point<T>::value)
-            ret._constraints.push_back(std::unique_ptr<_constraint>((_constraint *) (new _bound<long double>(mn, false))));
-        else
-            _api_assert(false, "called min with improper argument (not integral or floating point type)");
-        return ret;
+    arg arg::min(T mn) && {
+        _add_bound(mn, false, "min");
+        return std::move(*this);
     }
 
     template <typename T>
-    arg arg::max(T mx) const {
-        arg ret = *this;
-        ret._id.append_descr("[" + _without_hyphens(_id.longer()) + " <= " + std::to_string(mx) + "]");
-        if(std::is_integral<T>::value)
-            ret._constraints.push_back(std::unique_ptr<_constraint>((_constraint *) (new _bound<long long>(mx, true))));
-        else if(std::is_floating_point<T>::value)
-            ret._constraints.push_back(std::unique_ptr<_constraint>((_constraint *) (new _bound<long double>(mx, true))));
-        else
-            _api_assert(false, "called max with improper argument (not integral or floating point type)");
-        return ret;
+    arg arg::max(T mx) && {
+        _add_bound(mx, true, "max");
+        return std::move(*this);
     }
 
     template <typename T_min, typename T_max>
-    arg arg::bounds(T_min mn, T_max mx) const {
-        arg ret = *this;
-        ret._id.append_descr("[" + std::to_string(mn) + " <= " + _without_hyphens(_id.longer()) + " <= " + std::to_string(mx) + "]");
-
-        if(std::is_integral<T_min>::value)
-            ret._constraints.push_back(std::unique_ptr<_constraint>((_constraint *) (new _bound<long long>((long long) mn, false))));
-        else if(std::is_floating_point<T_min>::value)
-            ret._constraints.push_back(std::unique_ptr<_constraint>((_constraint *) (new _bound<long double>((long double) mn, false))));
-        else
-            _api_assert(false, "called bounds with improper argument (not integral or floating point type)");
+    arg arg::bounds(T_min mn, T_max mx) && {
+        _add_bound(mn, false, "bounds");
+        _add_bound(mx, true, "bounds");
+        return std::move(*this);
+    }
 
-        if(std::is_integral<T_max>::value)
-            ret._constraints.push_back(std::unique_ptr<_constraint>((_constraint *) (new _bound<long long>((long long) mx, true))));
-        else if(std::is_floating_point<T_max>::value)
-            ret._constraints.push_back(std::unique_ptr<_constraint>((_constraint *) (new _bound<long double>((long double) mx, true))));
-        else
-            _api_assert(false, "called bounds with improper argument (not integral or floating point type)");
 
-        return ret;
+    template<typename T>
+    arg arg::one_of(const std::initializer_list<T> &init_values) && {
+        return std::move(*this).one_of(std::vector<T>(init_values.begin(), init_values.end()));
     }
 
-
     template<typename T>
-    arg arg::one_of(const std::initializer_list<T> &init_values) {
+    arg arg::one_of(const std::vector<T> &init_values) && {
         using T_inter = typename std::conditional<std::is_same<T, const char *>::value, std::string, T>::type;
 
         std::vector<T_inter> values(init_values.begin(), init_values.end());
         _api_assert(! values.empty(), "one_of constraint with zero possible values supplied");
+        _constraints.add_one_of(_one_of(std::move(values)));
+        return std::move(*this);
+    }
 
-        std::stringstream descr;
-        descr << "[Possible values: (";
-        descr << values[0];
-        for(size_t i = 1; i < values.size(); ++i)
-            descr << ", " << values[i];
-        descr << ")]";
 
-        arg ret = *this;
-        ret._id.append_descr(descr.str());
-        ret._constraints.push_back(std::unique_ptr<_constraint>((_constraint *) (new _one_of(values))));
-        return ret;
+    template <typename S>
+    template <typename T>
+    schema<S>& schema<S>::add(T S::*member, arg declaration) {
+        _fields.push_back({std::move(declaration), [member](S &s, arg a) {
+            T value = a; // Copy-initialization converts the same way as fired_main's default arguments
+            s.*member = std::move(value);
+        }});
+        return *this;
+    }
+
+    template <typename S>
+    S schema<S>::parse(int argc, const char **argv) const {
+        // Declare all fields to the logger, this takes the place of the introspection call
+        _::logger() = _arg_logger();
+        _::matcher() = _matcher();
+        _::matcher().set_introspect(true);
+        S declared;
+        for(const field &f: _fields)
+            f.assign(declared, f.declaration);
+
+        _::matcher() = _matcher(argc, argv, (int) _fields.size(), true, _allow_unused);
+        _::logger() = _arg_logger();
+        _::logger().set_program_descr(_program_descr);
+
+        S parsed;
+        for(const field &f: _fields)
+            f.assign(parsed, f.declaration);
+        return parsed;
+    }
+
+
+    program::program(std::function<int()> fired_main, int main_args, const std::string &program_descr, bool allow_unused):
+        _main(std::move(fired_main)), _main_args(main_args), _allow_unused(allow_unused), _context(new context()) {
+        context::scope active(*_context);
+        _::matcher().set_allow_unused(_allow_unused);
+        if(_main_args > 0)
+            _introspect(_main_args, _main);
+        _::logger().set_program_descr(program_descr);
+        _::logger().freeze();
+    }
+
+    int program::run(int argc, const char **argv) {
+        context::scope active(*_context);
+        _context->last_error = optional<error>();
+        int ret = 0;
+        _call_escapable([&] {
+            _::matcher().reset(argc, argv, _main_args, true, _allow_unused);
+            ret = _main();
+        });
+        return _context->last_error.has_value() ? _context->last_error.value().code : ret;
+    }
+
+    void program::set_error_policy(error_policy policy) {
+#ifndef FIRE_EXCEPTIONS_ENABLED_
+        _api_assert(policy == error_policy::exit, "error policies other than error_policy::exit require exceptions");
+#endif
+        _context->on_error = policy;
+    }
+
+#ifdef FIRE_EXCEPTIONS_ENABLED_
+    bool program::parse(int argc, const char **argv) {
+        context::scope active(*_context);
+        _context->last_error = optional<error>();
+        _call_escapable([&] {
+            _::matcher().reset(argc, argv, _main_args, true, _allow_unused);
+            _::matcher().set_dry_run(true);
+            if(_main_args > 0)
+                _main();
+        });
+        _::matcher().set_dry_run(false);
+        return ! _context->last_error.has_value();
+    }
+#endif
+
+    int program::run_batch(std::istream &in, const std::string &executable) {
+        // Lines are only parsed: declarations come from the introspection in the constructor,
+        // and the line, words and argv buffers are reused
+        int status = 0;
+        size_t line_number = 0;
+        auto report = [&](int code) {
+            if(code == 0)
+                return;
+            std::cerr << "Line " << line_number << " exited with code " << code << std::endl;
+            status = _failure_code;
+        };
+
+        std::string line;
+        std::vector<std::string> words(1, executable);
+        std::vector<const char *> argv;
+        while(std::getline(in, line)) {
+            ++line_number;
+            size_t count = 1;
+            if(! _split_shell_words(line, words, count)) {
+                context::scope active(*_context);
+                _context->last_error = optional<error>();
+                _call_escapable([] { _fail(error(error::kind::input, _failure_code, "", "unterminated quote")); });
+                report(_context->last_error.value().code);
+                continue;
+            }
+            if(count == 1)
+                continue;
+
+            argv.resize(count + 1);
+            for(size_t i = 0; i < count; ++i)
+                argv[i] = words[i].c_str();
+            argv[count] = nullptr; // argv[argc] is a null pointer, as in main()
+            report(run((int) count, argv.data()));
+        }
+        return status;
+    }
+
+    // FIRE_BATCH runs fired_main for each line when `--fire-batch=FILE` (or `--fire-batch=-` for standard input)
+    // is the only argument, anything else runs it once as FIRE(...) does
+    inline bool _batch_requested(int argc, const char **argv) {
+        return argc == 2 && std::strncmp(argv[1], "--fire-batch=", std::strlen("--fire-batch=")) == 0;
+    }
+
+    inline int _batch_main(program &batch, const char **argv) { // Only called if _batch_requested()
+        const char *path = argv[1] + std::strlen("--fire-batch=");
+        std::ifstream file;
+        if(std::strcmp(path, "-") != 0) {
+            file.open(path);
+            _instant_assert(file.is_open(), std::string("can't open batch file ") + path, false);
+        }
+
+#ifdef FIRE_EXCEPTIONS_ENABLED_
+        batch.set_error_policy(error_policy::status);
+#endif
+        return batch.run_batch(file.is_open() ? file : std::cin, argv[0]);
+    }
+
+
+    std::string _subcommands_help(const subcommand *begin, const subcommand *end, const std::string &executable, _string_view filter) {
+        // Listed from the table alone, no subcommand is introspected
+        auto lowercase = [](std::string str) {
+            std::transform(str.begin(), str.end(), str.begin(), [](char c){ return (char) tolower(c); });
+            return str;
+        };
+        std::string needle = lowercase(filter.str());
+        std::vector<const subcommand *> listed;
+        size_t margin = 0;
+        for(const subcommand *sub = begin; sub != end; ++sub) {
+            if(lowercase(std::string(sub->name) + " " + sub->descr).find(needle) != std::string::npos) {
+                listed.push_back(sub);
+                margin = std::max(margin, strlen(sub->name));
+            }
+        }
+
+        std::string out = "\nUsage:\n  " + executable + " SUBCOMMAND [ARGUMENTS]\n\n";
+        if(! filter.empty() && listed.empty())
+            out.append("\nNo subcommands match \"").append(filter.data(), filter.size()).append("\"\n");
+        if(! listed.empty())
+            out += "\nSubcommands:\n";
+        for(const subcommand *sub: listed)
+            out.append("  ").append(sub->name).append(2 + margin - strlen(sub->name), ' ').append(sub->descr).append("\n");
+        out += "\nRun `" + executable + " SUBCOMMAND --help` for the arguments of a subcommand.\n\n";
+        return out;
+    }
+
+    int _subcommands_main(const subcommand *begin, const subcommand *end, int argc, const char **argv) {
+        std::string executable = argc > 0 ? argv[0] : "";
+        _string_view first = argc > 1 ? argv[1] : "";
+        if(first == "-h" || first == "--help" || first.substr(0, 7) == "--help=")
+            _fail(error(error::kind::help, 0, "", _subcommands_help(begin, end, executable, first.substr(first == "-h" ? 2 : 7))));
+
+        const subcommand *selected = std::find_if(begin, end, [&](const subcommand &sub) { return first == sub.name; });
+        if(selected == end) {
+            std::string names;
+            for(const subcommand *sub = begin; sub != end; ++sub)
+                names += (sub == begin ? "" : ", ") + std::string(sub->name);
+            _fail(error(error::kind::input, _failure_code, "", argc > 1 ?
+                        "unknown subcommand " + first.str() + ", expected one of (" + names + ")" :
+                        "subcommand required, one of (" + names + ")"));
+        }
+
+        // Help and errors of the subcommand show its name after the executable
+        std::string name = executable + " " + selected->name;
+        std::vector<const char *> sub_argv(argv + 1, argv + argc);
+        sub_argv[0] = name.c_str();
+        sub_argv.push_back(nullptr); // argv[argc] is a null pointer, as in main()
+        return selected->run((int) sub_argv.size() - 1, sub_argv.data());
+    }
+
+    _string_view _program_name(_string_view path) {
+        size_t start = path.size();
+        while(start > 0 && path[start - 1] != '/' && path[start - 1] != '\\')
+            --start;
+        _string_view name = path.substr(start);
+        if(name.size() <= 4)
+            return name;
+        _string_view extension = name.substr(name.size() - 4);
+#ifdef _WIN32
+        // File names are case-insensitive, so TOOL.EXE is as much an executable as tool.exe
+        bool is_exe = std::equal(extension.data(), extension.data() + 4, ".exe", [](char a, char b) { return tolower((unsigned char) a) == b; });
+#else
+        bool is_exe = extension == ".exe";
+#endif
+        return is_exe ? name.substr(0, name.size() - 4) : name;
+    }
+
+    int _multicall_main(const subcommand *begin, const subcommand *end, int argc, const char **argv) {
+        _string_view called = argc > 0 ? _program_name(argv[0]) : "";
+        for(const subcommand *sub = begin; sub != end; ++sub)
+            if(called == sub->name)
+                return sub->run(argc, argv);
+        return _subcommands_main(begin, end, argc, argv); // Called by the binary's own name, eg. `binary tool -x 1`
     }
 
 
@@ -1335,8 +2794,8 @@ namespace fire {
         if(id.get_type() == identifier::type::positional)
             return helpful_name(id.get_pos().value());
 
-        optional<std::string> matched_name = _::matcher.match_named(id);
-        return matched_name.value_or("");
+        optional<std::string> matched_name = _::matcher().match_named(id);
+        return std::move(matched_name).value_or("");
     }
 
     inline std::string helpful_name(int pos) {
@@ -1345,11 +2804,11 @@ namespace fire {
 
     inline std::string helpful_name(const std::string &name) {
         identifier id({name}, optional<int>());
-        optional<identifier> matched_id = _::logger.match_identifier(id);
-        _api_assert(matched_id.has_value(), "Identifier " + name + " has not been declared");
+        optional<identifier> matched_id = _::logger().match_identifier(id);
+        _api_assert(matched_id.has_value(), [&]{ return "Identifier " + name + " has not been declared"; });
 
-        optional<std::string> matched_name = _::matcher.match_named(matched_id.value());
-        return matched_name.value_or("");
+        optional<std::string> matched_name = _::matcher().match_named(matched_id.value());
+        return std::move(matched_name).value_or("");
     }
 }
 
@@ -1362,19 +2821,63 @@ namespace fire {
 #define PREPARE_FIRE_(argc, argv, allow_unused, ...) \
     int main_args = (int) fire::_get_argument_count(FIRE_EXTRACT_1_PAD_(__VA_ARGS__));\
     \
-    fire::_::logger = fire::_arg_logger();\
-    fire::_::matcher = fire::_matcher();\
-    fire::_::matcher.set_allow_unused(allow_unused);\
-    fire::_::logger.set_introspect_count(main_args);\
-    if(main_args > 0) {\
-        try {\
-            FIRE_EXTRACT_1_PAD_(__VA_ARGS__)(); /* function isn't actually executed, the last default argument will always throw */ \
-        } catch (fire::_escape_exception) {\
-        }\
-    }\
+    fire::_::logger() = fire::_arg_logger();\
+    fire::_::matcher() = fire::_matcher();\
+    fire::_::matcher().set_allow_unused(allow_unused);\
+    if(main_args > 0 && fire::_matcher::needs_introspection(argc, argv))\
+        fire::_introspect(main_args, []{ (void) FIRE_EXTRACT_1_PAD_(__VA_ARGS__)(); }); /* fired_main's body isn't run */ \
     \
-    fire::_::matcher = fire::_matcher(argc, argv, main_args, true, allow_unused);\
-    fire::_::logger = fire::_arg_logger();\
+    fire::_::matcher() = fire::_matcher(argc, argv, main_args, true, allow_unused);\
+    fire::_::logger() = fire::_arg_logger();\
+
+// FIRE_PROGRAM/FIRE_PROGRAM_ALLOW_UNUSED(fired_main[, program_descr]) create a reusable fire::program
+
+#define FIRE_PROGRAM(...) \
+    fire::program([]{ return FIRE_EXTRACT_1_PAD_(__VA_ARGS__)(); },\
+                  (int) fire::_get_argument_count(FIRE_EXTRACT_1_PAD_(__VA_ARGS__)), FIRE_EXTRACT_2_PAD_(__VA_ARGS__), false)
+
+#define FIRE_PROGRAM_ALLOW_UNUSED(...) \
+    fire::program([]{ return FIRE_EXTRACT_1_PAD_(__VA_ARGS__)(); },\
+                  (int) fire::_get_argument_count(FIRE_EXTRACT_1_PAD_(__VA_ARGS__)), FIRE_EXTRACT_2_PAD_(__VA_ARGS__), true)
+
+// FIRE_BATCH(fired_main[, program_descr]) is FIRE(...) that also accepts `--fire-batch=FILE|-`,
+// running fired_main once for each line of FILE or standard input
+
+#define FIRE_BATCH(...) \
+int main(int argc, const char ** argv) {\
+    if(fire::_batch_requested(argc, argv)) {\
+        fire::program batch = FIRE_PROGRAM(__VA_ARGS__);\
+        return fire::_batch_main(batch, argv);\
+    }\
+    PREPARE_FIRE_(argc, argv, false, __VA_ARGS__);\
+    fire::_::logger().set_program_descr(FIRE_EXTRACT_2_PAD_(__VA_ARGS__));\
+    return FIRE_EXTRACT_1_PAD_(__VA_ARGS__)();\
+}
+
+// FIRE_SUBCOMMANDS(FIRE_SUBCOMMAND(name, fired_main[, description]), ...) creates the main function that runs the
+// fired_main named by the first argument. Only that fired_main is introspected
+
+#define FIRE_SUBCOMMAND(name, ...) \
+    fire::subcommand{name, FIRE_EXTRACT_2_PAD_(__VA_ARGS__), [](int argc, const char **argv) -> int {\
+        PREPARE_FIRE_(argc, argv, false, __VA_ARGS__);\
+        fire::_::logger().set_program_descr(FIRE_EXTRACT_2_PAD_(__VA_ARGS__));\
+        return FIRE_EXTRACT_1_PAD_(__VA_ARGS__)();\
+    }}
+
+#define FIRE_SUBCOMMANDS(...) \
+int main(int argc, const char ** argv) {\
+    static const fire::subcommand subcommands[] = {__VA_ARGS__};\
+    return fire::_subcommands_main(subcommands, subcommands + sizeof(subcommands) / sizeof(subcommands[0]), argc, argv);\
+}
+
+// FIRE_MULTICALL(FIRE_SUBCOMMAND(name, fired_main[, description]), ...) creates the main function of a multi-call binary,
+// which runs the fired_main named by argv[0] (usually a symlink), or by the first argument otherwise
+
+#define FIRE_MULTICALL(...) \
+int main(int argc, const char ** argv) {\
+    static const fire::subcommand tools[] = {__VA_ARGS__};\
+    return fire::_multicall_main(tools, tools + sizeof(tools) / sizeof(tools[0]), argc, argv);\
+}
 
 // FIRE/FIRE_NO_EXCEPTIONS(fired_main[, program_descr])
 // optional parameters implemented using a trick similar to https://stackoverflow.com/a/3048361/6865804
@@ -1382,22 +2885,22 @@ namespace fire {
 #define FIRE(...) \
 int main(int argc, const char ** argv) {\
     PREPARE_FIRE_(argc, argv, false, __VA_ARGS__);\
-    fire::_::logger.set_program_descr(FIRE_EXTRACT_2_PAD_(__VA_ARGS__));\
+    fire::_::logger().set_program_descr(FIRE_EXTRACT_2_PAD_(__VA_ARGS__));\
     return FIRE_EXTRACT_1_PAD_(__VA_ARGS__)();\
 }
 
 #define FIRE_ALLOW_UNUSED(...) \
 int main(int argc, const char ** argv) {\
     PREPARE_FIRE_(argc, argv, true, __VA_ARGS__);\
-    fire::_::logger.set_program_descr(FIRE_EXTRACT_2_PAD_(__VA_ARGS__));\
+    fire::_::logger().set_program_descr(FIRE_EXTRACT_2_PAD_(__VA_ARGS__));\
     return FIRE_EXTRACT_1_PAD_(__VA_ARGS__)();\
 }
 
+// Kept for compatibility, FIRE also compiles with exceptions disabled
 #define FIRE_NO_EXCEPTIONS(...) \
 int main(int argc, const char ** argv) {\
-    int main_args = (int) fire::_get_argument_count(FIRE_EXTRACT_1_PAD_(__VA_ARGS__));\
-    fire::_::matcher = fire::_matcher(argc, argv, main_args, true, false);\
-    fire::_::logger.set_program_descr(FIRE_EXTRACT_2_PAD_(__VA_ARGS__));\
+    PREPARE_FIRE_(argc, argv, false, __VA_ARGS__);\
+    fire::_::logger().set_program_descr(FIRE_EXTRACT_2_PAD_(__VA_ARGS__));\
     return FIRE_EXTRACT_1_PAD_(__VA_ARGS__)();\
 }
 
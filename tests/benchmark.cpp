@@ -0,0 +1,133 @@
+
+/*
+    Copyright Kristjan Kongas 2020-2024
+
+    Boost Software License - Version 1.0 - August 17th, 2003
+
+    Permission is hereby granted, free of charge, to any person or organization
+    obtaining a copy of the software and accompanying documentation covered by
+    this license (the "Software") to use, reproduce, display, distribute,
+    execute, and transmit the Software, and to prepare derivative works of the
+    Software, and to permit third-parties to whom the Software is furnished to
+    do so, all subject to the following:
+
+    The copyright notices in the Software and this entire statement, including
+    the above license grant, this restriction and the following disclaimer,
+    must be included in all copies of the Software, in whole or in part, and
+    all derivative works of the Software, unless such copies or derivative
+    works are solely in the form of machine-executable object code generated by
+    a source language processor.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+    SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+    FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+    ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+    DEALINGS IN THE SOFTWARE.
+*/
+
+// Measures fire's startup cost for the all_combinations example, with values given as `-i=0` (introspection skipped)
+// and as `-i 0` (introspection needed to tell that 0 is a value), a reused fire::program, and help rendering for thousands
+// of arguments. Not part of the standard tests
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "fire-hpp/fire.hpp"
+
+using namespace std;
+
+int fired_main(
+        int = fire::arg({"-i", "Integer"}),
+        double = fire::arg({"-r", "--def-r", "Real value with default"}, 1),
+        fire::optional<string> = fire::arg({"-s", "--opt-s", "Optional string"}),
+        unsigned = fire::arg({0, "Positive integer"}),
+        fire::optional<int> = fire::arg({1, "Optional positive integer"}),
+        bool = fire::arg({"-f", "--flag"})
+        ) {
+    return 0;
+}
+
+double time_startup(const vector<const char *> &args, int runs) {
+    int argc = (int) args.size();
+    const char **argv = const_cast<const char **>(args.data());
+
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < runs; ++i) {
+        PREPARE_FIRE_(argc, argv, false, fired_main);
+        fired_main();
+    }
+    chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / runs;
+}
+
+double time_program(const vector<const char *> &args, int runs) {
+    int argc = (int) args.size();
+    const char **argv = const_cast<const char **>(args.data());
+    fire::program program = FIRE_PROGRAM(fired_main);
+
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < runs; ++i)
+        program.run(argc, argv);
+    chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / runs;
+}
+
+double time_batch(int lines) {
+    string input;
+    for(int i = 0; i < lines; ++i)
+        input += "0 1 -i " + to_string(i) + " --def-r 0.0 --opt-s 'quoted string'\n";
+    istringstream in(input);
+    fire::program program = FIRE_PROGRAM(fired_main);
+
+    auto start = chrono::steady_clock::now();
+    program.run_batch(in, "./benchmark");
+    chrono::duration<double, micro> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count() / lines;
+}
+
+// Discards everything written to it, so that only formatting is timed
+struct null_buffer: streambuf {
+    int overflow(int c) override { return c; }
+    streamsize xsputn(const char *, streamsize n) override { return n; }
+};
+
+double time_help(int options, int runs) {
+    const char *argv[] = {"./benchmark"};
+    fire::_::logger() = fire::_arg_logger();
+    fire::_::matcher() = fire::_matcher(1, argv, options, false, false);
+
+    vector<string> names, descriptions;
+    for(int i = 0; i < options; ++i) {
+        names.push_back("--option-" + to_string(i));
+        descriptions.push_back("Description of option number " + to_string(i));
+    }
+    for(int i = 0; i < options; ++i)
+        (void) (int) fire::arg({names[i].c_str(), descriptions[i].c_str()}, i);
+
+    null_buffer sink;
+    streambuf *cerr_buf = cerr.rdbuf(&sink);
+    auto start = chrono::steady_clock::now();
+    for(int i = 0; i < runs; ++i)
+        fire::print_help();
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    cerr.rdbuf(cerr_buf);
+    return elapsed.count() / runs;
+}
+
+int main(int argc, const char **argv) {
+    int runs = argc > 1 ? stoi(argv[1]) : 100000;
+
+    vector<const char *> introspected = {"./benchmark", "0", "1", "-i", "0", "--def-r", "0.0", "--opt-s", "string"};
+    vector<const char *> skipped = {"./benchmark", "0", "1", "-i=0", "--def-r=0.0", "--opt-s=string"};
+
+    cout << "introspection needed:  " << time_startup(introspected, runs) << " us per startup" << endl;
+    cout << "introspection skipped: " << time_startup(skipped, runs) << " us per startup" << endl;
+    cout << "fire::program:         " << time_program(introspected, runs) << " us per command line" << endl;
+    cout << "FIRE_BATCH lines:      " << time_batch(runs) << " us per line" << endl;
+    cout << "help with 3000 options: " << time_help(3000, 100) << " ms per print" << endl;
+    return 0;
+}
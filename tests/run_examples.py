@@ -27,7 +27,7 @@
     DEALINGS IN THE SOFTWARE.
 """
 
-import subprocess, json
+import subprocess, json, tempfile, os
 from pathlib import Path
 
 fire_failure_code = 1
@@ -41,6 +41,7 @@ class assert_runner:
         assert_runner.test_count += 1
         self.help_success("-h")
         self.help_success("--help")
+        self.help_success("--help=x")
 
     def equal(self, cmd, out):
         stdout, stderr, code = self.run(cmd)
@@ -63,8 +64,8 @@ class assert_runner:
         assert stderr != ""
         assert_runner.check_count += 1
 
-    def run(self, cmd):
-        result = subprocess.run([self.pth] + cmd.split(), stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    def run(self, cmd, input=None):
+        result = subprocess.run([self.pth] + cmd.split(), input=input, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
         stdout = self.remove_newline(self.b2str(result.stdout.strip()))
         stderr = self.remove_newline(self.b2str(result.stderr.strip()))
         code = result.returncode
@@ -106,6 +107,15 @@ def run_add(path_prefix):
     runner.handled_failure("-x -1200 -y 0")
     runner.handled_failure("-x 1200 -y 0")
 
+    with tempfile.NamedTemporaryFile("w", suffix=".txt", delete=False) as response_file:
+        response_file.write("-x 3\n-y '4' # comment\n")
+    try:
+        runner.equal("@" + response_file.name, "3 + 4 = 7")
+        runner.equal("@" + response_file.name + " --mul -1", "-1 * (3 + 4) = -7")
+        runner.handled_failure("@" + response_file.name + ".missing")
+    finally:
+        os.remove(response_file.name)
+
 
 def run_post_call(path_prefix):
     runner = assert_runner(path_prefix / "post_call")
@@ -176,12 +186,68 @@ def run_variadic(path_prefix):
     runner.equal("a -- -b", "a -b\n")
 
 
+def run_schema(path_prefix):
+    runner = assert_runner(path_prefix / "schema")
+
+    runner.equal("-x 3 -y 4", "3 + 4 = 7")
+    runner.equal("-x=-3 -y 3", "-3 + 3 = 0")
+    runner.equal("-x3 -y4 --mul -1", "-1 * (3 + 4) = -7")
+    runner.handled_failure("-x 3")
+    runner.handled_failure("-x 3 -y 4 --mul 2")
+    runner.handled_failure("-x 1200 -y 0")
+    runner.handled_failure("--undefined 0")
+
+
+def run_batch(path_prefix):
+    runner = assert_runner(path_prefix / "batch")
+
+    runner.equal("-x 3 -y 4", "3 + 4 = 7")
+    runner.handled_failure("-x 3")
+
+    lines = b"-x 1 -y 2\n\n# comment\n-x=3 '-y' \"4\"\n"
+    stdout, stderr, code = runner.run("--fire-batch=-", lines)
+    assert code == 0
+    assert stdout == "1 + 2 = 3" + "3 + 4 = 7"
+    assert stderr == ""
+    assert_runner.check_count += 1
+
+    stdout, stderr, code = runner.run("--fire-batch=-", b"-x 1 -y 2\n-x 1\n-x 5000 -y 0\n-x 'unterminated\n-x 2 -y 2\n")
+    assert code == fire_failure_code
+    assert stdout == "1 + 2 = 3" + "2 + 2 = 4"
+    assert "Line 2 exited" in stderr and "Line 3 exited" in stderr and "Line 4 exited" in stderr
+    assert "Line 5 exited" not in stderr
+    assert_runner.check_count += 1
+
+
+def run_subcommands(path_prefix):
+    runner = assert_runner(path_prefix / "subcommands")
+
+    runner.equal("add -x 1 -y 2", "1 + 2 = 3")
+    runner.equal("repeat hi", "hi hi")
+    runner.equal("repeat hi --count 3", "hi hi hi")
+    runner.help_success("add --help")
+    runner.help_success("repeat -h")
+    runner.handled_failure("")
+    runner.handled_failure("subtract -x 1 -y 2")
+    runner.handled_failure("add -x 1")
+    runner.handled_failure("repeat hi -n -1")
+
+    _, help_err, _ = runner.run("--help")
+    assert "Adds two numbers" in help_err and "Prints text several times" in help_err
+    _, filtered_err, _ = runner.run("--help=print")
+    assert "Adds two numbers" not in filtered_err and "Prints text several times" in filtered_err
+    _, add_err, _ = runner.run("add --help")
+    assert "subcommands add -x=INTEGER -y=INTEGER" in add_err
+    assert_runner.check_count += 1
+
+
 def run_no_exceptions(path_prefix):
     runner = assert_runner(path_prefix / "no_exceptions")
 
     runner.equal("", "\n")
     runner.equal("1 2", "1 2 \n")
     runner.equal("1 2 -r=2", "1 2 \n1 2 \n")
+    runner.handled_failure("1 2 -r=x")
     stdout, stderr, code = runner.run("-h")
     assert stderr.find("Notes") != -1
 
@@ -206,6 +272,9 @@ def main():
     run_positional(path_prefix)
     run_raw_args(path_prefix)
     run_variadic(path_prefix)
+    run_schema(path_prefix)
+    run_batch(path_prefix)
+    run_subcommands(path_prefix)
 
     run_no_exceptions(path_prefix)
 
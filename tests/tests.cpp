@@ -27,24 +27,51 @@
     DEALINGS IN THE SOFTWARE.
 */
 
+#include <atomic>
+#include <fstream>
+#include <thread>
 #include <gtest/gtest.h>
 #include "fire-hpp/fire.hpp"
 
-#define EXPECT_EXIT_SUCCESS(statement) EXPECT_EXIT(statement, ::testing::ExitedWithCode(0), "")
-#define EXPECT_EXIT_FAIL(statement) EXPECT_EXIT(statement, ::testing::ExitedWithCode(_failure_code), "")
-
 using namespace std;
 using namespace fire;
 
-void init_args(const vector<string> &args, bool strict, int named_calls = 1000000) {
-    const char ** argv = new const char *[args.size()];
-    for(size_t i = 0; i < args.size(); ++i)
-        argv[i] = args[i].c_str();
+// Errors are thrown instead of ending the process, so they're checked in-process rather than with death tests
+template <typename F>
+int exit_code(const F &f) {
+    _::current().on_error = error_policy::exception;
+    try {
+        f();
+    } catch(const fire::error &e) {
+        return e.code;
+    }
+    return -1;
+}
+
+#define EXPECT_EXIT_SUCCESS(statement) EXPECT_EQ(exit_code([&]{ statement; }), 0)
+#define EXPECT_EXIT_FAIL(statement) EXPECT_EQ(exit_code([&]{ statement; }), _failure_code)
 
-    _::logger = _arg_logger();
-    _::matcher = _matcher((int) args.size(), argv, named_calls, strict, false);
+// Counts heap allocations (see allocations.cpp), so tests can check that values are moved rather than copied
+extern atomic<size_t> allocation_count;
 
-    delete [] argv;
+template <typename F>
+size_t count_allocations(const F &f) {
+    size_t before = allocation_count;
+    f();
+    return allocation_count - before;
+}
+
+void init_args(const vector<string> &args, bool strict, int named_calls = 1000000) {
+    // Matcher points into argv instead of copying it, so argv must outlive the matcher
+    static vector<string> stored_args;
+    static vector<const char *> argv;
+    stored_args = args;
+    argv.resize(stored_args.size());
+    for(size_t i = 0; i < stored_args.size(); ++i)
+        argv[i] = stored_args[i].c_str();
+
+    _::logger() = _arg_logger();
+    _::matcher() = _matcher((int) argv.size(), argv.data(), named_calls, strict, false);
 }
 
 void init_args(const vector<string> &args) {
@@ -74,6 +101,80 @@ TEST(functions, _replace_all) {
     EXPECT_EQ(_replace_all("go", " ", "--"), "go");
 }
 
+TEST(functions, _split_shell_words) {
+    vector<string> words;
+    auto split = [&](const string &line) {
+        size_t count = 0;
+        EXPECT_TRUE(_split_shell_words(line, words, count));
+        return vector<string>(words.begin(), words.begin() + (ptrdiff_t) count);
+    };
+
+    EXPECT_EQ(split("  -x 1\t--name=value  "), vector<string>({"-x", "1", "--name=value"}));
+    EXPECT_EQ(split("'single quoted' \"double \\\"quoted\\\" \\n\" back\\ slash"),
+              vector<string>({"single quoted", "double \"quoted\" \\n", "back slash"}));
+    EXPECT_EQ(split("'' a''b \"\" # comment"), vector<string>({"", "ab", ""}));
+    EXPECT_EQ(split("x#y # comment"), vector<string>({"x#y"}));
+    EXPECT_EQ(split(""), vector<string>());
+    EXPECT_EQ(words.size(), 3u); // Earlier words are kept for reuse
+
+    size_t count = 0;
+    EXPECT_FALSE(_split_shell_words("-x 'unterminated", words, count));
+    count = 0;
+    EXPECT_FALSE(_split_shell_words("-x \"unterminated\\\"", words, count));
+}
+
+TEST(functions, _from_chars_integral) {
+    int8_t i8 = 0;
+    EXPECT_EQ(_from_chars("127", i8), _parse_result::ok);
+    EXPECT_EQ(i8, 127);
+    EXPECT_EQ(_from_chars("-128", i8), _parse_result::ok);
+    EXPECT_EQ(i8, -128);
+    EXPECT_EQ(_from_chars("128", i8), _parse_result::out_of_range);
+    EXPECT_EQ(_from_chars("-129", i8), _parse_result::out_of_range);
+
+    uint64_t u64 = 0;
+    EXPECT_EQ(_from_chars("18446744073709551615", u64), _parse_result::ok);
+    EXPECT_EQ(u64, numeric_limits<uint64_t>::max());
+    EXPECT_EQ(_from_chars("18446744073709551616", u64), _parse_result::out_of_range);
+    EXPECT_EQ(_from_chars("-1", u64), _parse_result::out_of_range);
+    EXPECT_EQ(_from_chars("-0", u64), _parse_result::ok);
+    EXPECT_EQ(u64, 0u);
+
+    int i = 0;
+    EXPECT_EQ(_from_chars("+42", i), _parse_result::ok);
+    EXPECT_EQ(i, 42);
+    EXPECT_EQ(_from_chars("", i), _parse_result::invalid);
+    EXPECT_EQ(_from_chars("-", i), _parse_result::invalid);
+    EXPECT_EQ(_from_chars("1a", i), _parse_result::invalid);
+    EXPECT_EQ(_from_chars(" 1", i), _parse_result::invalid);
+    EXPECT_EQ(_from_chars("99999999999999999999x", i), _parse_result::invalid);
+}
+
+TEST(functions, _from_chars_floating_point) {
+    vector<string> exact = {"0", "-0.0", "1.5", ".5", "5.", "0.1", "-2.5e-3", "1E10", "123456789012345678901234567890",
+                            "3.14159265358979323846264338327950288", "2.2250738585072014e-308", "1e-320", "7e22", "9007199254740993"};
+    for(const string &str: exact) {
+        double d = 0;
+        EXPECT_EQ(_from_chars(str, d), _parse_result::ok) << str;
+        EXPECT_EQ(d, strtod(str.c_str(), nullptr)) << str;
+
+        float f = 0;
+        EXPECT_EQ(_from_chars(str, f), _parse_result::ok) << str;
+        EXPECT_EQ(f, strtof(str.c_str(), nullptr)) << str;
+    }
+
+    double d = 0;
+    EXPECT_EQ(_from_chars("0e999999999", d), _parse_result::ok);
+    EXPECT_EQ(d, 0.0);
+    EXPECT_EQ(_from_chars("1e309", d), _parse_result::out_of_range);
+    EXPECT_EQ(_from_chars("-1e309", d), _parse_result::out_of_range);
+
+    float f = 0;
+    EXPECT_EQ(_from_chars("1e39", f), _parse_result::out_of_range);
+    for(const char *invalid: {"", ".", "-", "e5", "1e", "1e+", "1.2.3", "0x10", "inf", "nan", " 1", "1,5"})
+        EXPECT_EQ(_from_chars(invalid, d), _parse_result::invalid) << invalid;
+}
+
 TEST(optional, value) {
     fire::optional<int> no_value;
     EXPECT_FALSE((bool) no_value);
@@ -97,6 +198,22 @@ TEST(optional, assignment) {
     EXPECT_TRUE(opt1.has_value());
 }
 
+TEST(optional, move) {
+    string long_string(100, 'x');
+    fire::optional<string> opt;
+    opt = string(long_string);
+    EXPECT_EQ(opt.value(), long_string);
+
+    fire::optional<string> moved;
+    EXPECT_EQ(count_allocations([&]{ moved = std::move(opt); }), 0u);
+    EXPECT_EQ(moved.value(), long_string);
+    EXPECT_EQ(count_allocations([&]{ string s = std::move(moved).value_or(""); }), 0u);
+
+    fire::optional<string> emplaced;
+    EXPECT_EQ(emplaced.emplace(3, 'y'), "yyy");
+    EXPECT_TRUE(emplaced.has_value());
+}
+
 TEST(optional, no_value) {
     fire::optional<int> opt;
     EXPECT_FALSE((bool) opt);
@@ -128,6 +245,31 @@ TEST(c_args, operators) {
     EXPECT_STREQ(args1.argv()[0], "./another_executable");
 }
 
+TEST(c_args, view) {
+    const char *argv[] = {"./executable", "--arg"};
+    c_args view;
+    view.view(2, argv);
+    EXPECT_EQ(view.argc(), 2);
+    EXPECT_EQ(view.argv()[1], argv[1]); // Not copied
+
+    c_args copy(view);
+    EXPECT_NE(copy.argv()[1], argv[1]);
+    EXPECT_STREQ(copy.argv()[1], "--arg");
+}
+
+TEST(c_args, move) {
+    c_args owned("./executable", {"--arg"});
+    char **argv = owned.argv();
+    c_args moved;
+    EXPECT_EQ(count_allocations([&]{ moved = std::move(owned); }), 0u);
+    EXPECT_EQ(moved.argv(), argv);
+    EXPECT_EQ(owned.argc(), 0);
+
+    c_args constructed(std::move(moved));
+    EXPECT_EQ(constructed.argv(), argv);
+    EXPECT_STREQ(constructed.argv()[1], "--arg");
+}
+
 
 TEST(identifier, prepend_hyphens) {
     EXPECT_EQ(identifier::prepend_hyphens(""), "");
@@ -223,6 +365,73 @@ TEST(identifier, contains) {
     EXPECT_FALSE(pos.contains(1));
 }
 
+TEST(identifier, shared_names) {
+    fire::optional<int> empty;
+    identifier a(vector<string>{"-a", "--alpha", "descr"}, empty), b(vector<string>{"--alpha"}, empty);
+
+    EXPECT_EQ(a.plain_long(), b.plain_long());
+    EXPECT_EQ(a.plain_long(), "alpha");
+    EXPECT_EQ(a.plain_short(), "a");
+    EXPECT_EQ(b.plain_short(), "");
+    EXPECT_EQ(a.short_name(), fire::optional<string>("-a"));
+    EXPECT_EQ(b.short_name(), fire::optional<string>());
+    EXPECT_LT(sizeof(identifier), 3 * sizeof(string));
+
+    // Equal names have the same process-wide id, which is what comparisons use
+    EXPECT_NE(a.long_id(), 0);
+    EXPECT_EQ(a.long_id(), b.long_id());
+    EXPECT_NE(a.short_id(), a.long_id());
+    EXPECT_EQ(b.short_id(), 0);
+    EXPECT_TRUE(a.overlaps(b));
+    EXPECT_FALSE(a == b);
+
+    // Copies share names, appending a description changes only the copy
+    identifier copy = a;
+    EXPECT_EQ(&copy.plain_long(), &a.plain_long());
+    copy.append_descr("appended");
+    EXPECT_EQ(copy.get_descr(), "descr appended");
+    EXPECT_EQ(a.get_descr(), "descr");
+
+    // Names don't depend on the context an identifier was created in
+    fire::context other;
+    fire::context::scope active(other);
+    EXPECT_TRUE(a.contains("--alpha"));
+    EXPECT_EQ(a.help(), "-a|--alpha");
+}
+
+TEST(identifier, entries_from_arrays) {
+    static const char name[] = "--name";
+    char buffer[32] = "-x"; // Holds a shorter string than its size
+    EXPECT_EQ(_identifier_entry(buffer).size, 2u);
+
+    init_args({"./run_tests", "--name=a", "-x=b"});
+    EXPECT_EQ((string) arg(name), "a");
+    EXPECT_EQ((string) arg({buffer, "descr"}), "b");
+}
+
+TEST(identifier, entry_classification) {
+    fire::optional<int> empty;
+    using kind = _identifier_entry::kind;
+    static_assert(_identifier_entry::classify("-x", 2) == kind::shorthand, "");
+    static_assert(_identifier_entry::classify("--long", 6) == kind::long_name, "");
+    static_assert(_identifier_entry::classify("<name>", 6) == kind::positional_name, "");
+    static_assert(_identifier_entry::classify("descr", 5) == kind::description, "");
+    static_assert(_identifier_entry::classify("", 0) == kind::description, "");
+    static_assert(_identifier_entry::classify("---x", 4) == kind::too_many_hyphens, "");
+    static_assert(_identifier_entry::classify("-xy", 3) == kind::shorthand_not_one_character, "");
+    static_assert(_identifier_entry::classify("-", 1) == kind::shorthand_not_one_character, "");
+    static_assert(_identifier_entry::classify("-1", 2) == kind::shorthand_starts_with_number, "");
+    static_assert(_identifier_entry::classify("--x", 3) == kind::long_name_too_short, "");
+
+    const char *runtime_name = "--long";
+    EXPECT_EQ(_identifier_entry(runtime_name).k, kind::long_name);
+    EXPECT_EQ(_identifier_entry(3).k, kind::index);
+    EXPECT_EQ(_identifier_entry(variadic()).k, kind::variadic);
+
+    EXPECT_EXIT_FAIL(identifier(vector<string>{"-x"}, empty, true));
+    EXPECT_EXIT_FAIL(identifier(vector<string>{"<name>"}, empty));
+}
+
 TEST(identifier, help) {
     fire::optional<int> empty;
 
@@ -334,14 +543,126 @@ TEST(matcher, no_space_assignment) {
     EXPECT_EXIT_FAIL((void) (int) arg("-x"));
 }
 
+TEST(matcher, tokens) {
+    init_args({"./run_tests", "-ab", "--long=value", "-x=1", "--", "-c"});
+    const vector<_token> &tokens = _::matcher().get_tokens();
+    ASSERT_EQ(tokens.size(), 5u);
+
+    EXPECT_EQ(tokens[0].k, _token::kind::flag);
+    EXPECT_EQ(tokens[0].name_with_hyphens(), "-a");
+    EXPECT_EQ(tokens[1].name_with_hyphens(), "-b");
+    EXPECT_EQ(tokens[2].k, _token::kind::named);
+    EXPECT_EQ(tokens[2].name_with_hyphens(), "--long");
+    EXPECT_EQ(tokens[2].value.str(), "value");
+    EXPECT_EQ(tokens[3].value.str(), "1");
+    EXPECT_EQ(tokens[4].k, _token::kind::positional);
+    EXPECT_EQ(tokens[4].value.str(), "-c");
+
+    // Spans point into argv
+    const char *long_arg = fire::raw_args.argv()[2];
+    EXPECT_EQ(tokens[2].name.data(), long_arg + 2);
+    EXPECT_EQ(tokens[2].value.data(), long_arg + 7);
+}
+
+TEST(matcher, index) {
+    init_args({"./run_tests", "--verbose", "-v"});
+    EXPECT_EQ(_::matcher().match_named(identifier({"-v", "--verbose"}, fire::optional<int>())), fire::optional<string>("--verbose"));
+
+    vector<string> args = {"./run_tests"};
+    for(int i = 0; i < 1000; ++i)
+        args.push_back("--arg" + to_string(i) + "=" + to_string(i));
+    init_args_strict(args, 1000);
+    for(int i = 999; i >= 0; --i)
+        EXPECT_EQ((int) arg(("--arg" + to_string(i)).c_str()), i);
+}
+
+TEST(matcher, long_arguments) {
+    string value(1 << 22, 'x');
+    init_args({"./run_tests", "--long=" + value + "=" + value, value, "-5"});
+    const vector<_token> &tokens = _::matcher().get_tokens();
+    ASSERT_EQ(tokens.size(), 3u);
+    EXPECT_EQ(tokens[0].name.str(), "long");
+    EXPECT_EQ(tokens[0].value.size(), 2 * value.size() + 1);
+    EXPECT_EQ(tokens[1].value.size(), value.size());
+    EXPECT_EQ(tokens.back().k, _token::kind::positional);
+    EXPECT_EQ(tokens.back().value.str(), "-5");
+}
+
+TEST(matcher, needs_introspection) {
+    auto needs = [](vector<const char *> argv) { return _matcher::needs_introspection((int) argv.size(), argv.data()); };
+
+    EXPECT_FALSE(needs({"./run_tests"}));
+    EXPECT_FALSE(needs({"./run_tests", "0", "-x=1", "--name=value", "-5", "-3", "---x", "value"}));
+    EXPECT_FALSE(needs({"./run_tests", "0", "--flag"}));
+    EXPECT_FALSE(needs({"./run_tests", "--flag", "--", "value"}));
+    EXPECT_FALSE(needs({"./run_tests", "--", "--name", "value", "-abc"}));
+
+    EXPECT_TRUE(needs({"./run_tests", "--name", "value"}));
+    EXPECT_TRUE(needs({"./run_tests", "-x", "1"}));
+    EXPECT_TRUE(needs({"./run_tests", "--flag", "--name=value"}));
+    EXPECT_TRUE(needs({"./run_tests", "-j8"}));
+    EXPECT_TRUE(needs({"./run_tests", "-ab=0"}));
+    EXPECT_TRUE(needs({"./run_tests", "@args.txt"}));
+    EXPECT_FALSE(needs({"./run_tests", "@"}));
+}
+
+bool response_values_inside = false;
+
+int response_values_main(string s = arg("-s"), string name = arg("--name"), int x = arg("-x")) {
+    EXPECT_EQ(s, "@not-a-file");
+    EXPECT_EQ(name, "@literal");
+    EXPECT_EQ(x, 1);
+    response_values_inside = true;
+    return 0;
+}
+
+TEST(matcher, response_files) {
+    auto write = [](const string &name, const string &contents) {
+        string path = testing::TempDir() + name;
+        ofstream(path) << contents;
+        return "@" + path;
+    };
+    string nested = write("fire_nested.txt", "-z=3 # comment\n'quoted value'");
+    string outer = write("fire_outer.txt", "-x=1\n  --name=\"two words\" " + nested + "\n-- @not-a-file");
+
+    init_args({"./run_tests", "-y=2", outer, "last"});
+    EXPECT_EQ((int) arg("-x"), 1);
+    EXPECT_EQ((int) arg("-y"), 2);
+    EXPECT_EQ((int) arg("-z"), 3);
+    EXPECT_EQ((string) arg("--name"), "two words");
+    vector<string> rest = arg(variadic());
+    EXPECT_EQ(rest, vector<string>({"quoted value", "@not-a-file", "last"}));
+
+    // Arguments are kept both as given and with response files expanded
+    EXPECT_EQ(raw_args.argc(), 4);
+    EXPECT_EQ(string(raw_args.argv()[2]), outer);
+    ASSERT_EQ(raw_args.expanded().argc(), 9);
+    EXPECT_EQ(string(raw_args.expanded().argv()[3]), "--name=two words");
+    EXPECT_EQ(raw_args.expanded().argv()[9], nullptr);
+
+    init_args({"./run_tests", "--", outer});
+    vector<string> literal = arg(variadic());
+    EXPECT_EQ(literal, vector<string>({outer}));
+
+    string cycle = write("fire_cycle.txt", "-x 1 @" + testing::TempDir() + "fire_cycle.txt");
+    EXPECT_EXIT_FAIL(init_args({"./run_tests", cycle}));
+    EXPECT_EXIT_FAIL(init_args({"./run_tests", write("fire_unterminated.txt", "-x 'unterminated")}));
+    EXPECT_EXIT_FAIL(init_args({"./run_tests", "@" + testing::TempDir() + "fire_missing.txt"}));
+
+    // Values of options are kept as given, in argv and in response files
+    vector<string> values = {"./run_tests", "-s", "@not-a-file", write("fire_values.txt", "-x 1 --name @literal")};
+    CALL_WITH_INTROSPECTION(response_values_main, values);
+    EXPECT_TRUE(response_values_inside);
+}
+
 TEST(matcher, match_named) {
     init_args({"./run_tests", "-s", "--longer"});
     (void) (bool) arg({"-s", "--short"});
     (void) (bool) arg({"-l", "--longer"});
 
-    EXPECT_EQ(_::matcher.match_named(identifier({"-s", "--short"}, fire::optional<int>())), fire::optional<string>("-s"));
-    EXPECT_EQ(_::matcher.match_named(identifier({"-l", "--longer"}, fire::optional<int>())), fire::optional<string>("--longer"));
-    EXPECT_EQ(_::matcher.match_named(identifier({"-n", "--not-listed"}, fire::optional<int>())), fire::optional<string>());
+    EXPECT_EQ(_::matcher().match_named(identifier({"-s", "--short"}, fire::optional<int>())), fire::optional<string>("-s"));
+    EXPECT_EQ(_::matcher().match_named(identifier({"-l", "--longer"}, fire::optional<int>())), fire::optional<string>("--longer"));
+    EXPECT_EQ(_::matcher().match_named(identifier({"-n", "--not-listed"}, fire::optional<int>())), fire::optional<string>());
 }
 
 
@@ -392,6 +713,7 @@ TEST(arg, argument_naming) {
     EXPECT_EXIT_FAIL(arg("---cmon", "test"));
 
     EXPECT_EXIT_FAIL(arg("-1", 0));
+    EXPECT_EXIT_FAIL(arg("-1x", 0));
     (void) arg("--1e3", 0);
     (void) arg("--a3");
 }
@@ -482,6 +804,37 @@ TEST(arg, all_positional_parsing) {
     EXPECT_EQ(all2, vector<string>({"text"}));
 }
 
+TEST(arg, positional_vector_elements) {
+    // Elements don't build identifiers of their own, the position appears only in error messages
+    vector<string> args = {"./run_tests"};
+    for(int i = 0; i < 1000; ++i)
+        args.push_back(to_string(i));
+    init_args(args);
+    size_t allocations = count_allocations([] { vector<int> all = arg(variadic()); });
+    EXPECT_LT(allocations, 10u);
+
+    init_args({"./run_tests", "1", "x"});
+    _::current().on_error = error_policy::exception;
+    try {
+        vector<int> all = arg(variadic());
+        ADD_FAILURE();
+    } catch(const fire::error &e) {
+        EXPECT_NE(e.message.find("<1> value x"), string::npos) << e.message;
+    }
+}
+
+TEST(arg, many_positional_parsing) {
+    vector<string> args = {"./run_tests"};
+    for(int i = 0; i < 100000; ++i)
+        args.push_back(to_string(i));
+    init_args_strict(args, 1);
+
+    vector<int> all = arg(variadic());
+    ASSERT_EQ(all.size(), 100000u);
+    for(int i = 0; i < 100000; ++i)
+        EXPECT_EQ(all[i], i);
+}
+
 TEST(arg, double_dash_separator) {
     init_args({"./run_tests", "--"});
     vector<string> all0 = arg(variadic());
@@ -520,6 +873,21 @@ TEST(arg, precision) {
     EXPECT_EXIT_FAIL((void) (float) arg("-a", 1e100));
 }
 
+TEST(arg, fluent_calls_move) {
+    init_args({"./run_tests"});
+    const char *descr = "a description too long for the small string buffer";
+
+    // Help text is only formatted when printed and copies share the identifier's names, so bounds and copies don't allocate
+    size_t construction = count_allocations([&]{ (void) arg({"-x", descr}); });
+    EXPECT_LE(construction, 2u);
+    EXPECT_EQ(count_allocations([&]{ (void) arg({"-x", descr}).min(0).max(10); }), construction);
+    arg base({"-x", descr});
+    EXPECT_EQ(count_allocations([&]{ (void) base.min(0).max(10); }), 0u);
+
+    size_t one_of = count_allocations([&]{ (void) arg({"-x", descr}).one_of({1, 2, 3}); });
+    EXPECT_EQ(count_allocations([&]{ (void) arg({"-x", descr}).one_of({1, 2, 3}).min(0).max(10); }), one_of);
+}
+
 TEST(arg, bounds) {
     init_args({"./run_tests", "0", "1", "2", "3"});
     EXPECT_EXIT_FAIL((void) (int) arg(0).min(1));
@@ -544,6 +912,22 @@ TEST(arg, bounds) {
     EXPECT_EXIT_FAIL((void) (int) arg(0).bounds(-1.5, 1));
     EXPECT_EXIT_FAIL((void) (int) arg(0).bounds(-1, 1.5));
     (void) (double) arg(0).bounds(-1, 1);
+
+    init_args({"./run_tests", "18446744073709551615"});
+    (void) (uint64_t) arg(0).min(-1);
+    EXPECT_EXIT_FAIL((void) (uint64_t) arg(0).max(10));
+    (void) (uint64_t) arg(0).min(18446744073709551615ULL);
+    EXPECT_EXIT_FAIL((void) (int64_t) arg(0).min(18446744073709551615ULL));
+
+    init_args({"./run_tests", "2"});
+    EXPECT_EXIT_FAIL((void) (int) arg(0).min(3).min(1));
+    EXPECT_EXIT_FAIL((void) (int) arg(0).min(1).min(3));
+    EXPECT_EXIT_FAIL((void) (int) arg(0).max(1).max(3));
+    EXPECT_EXIT_FAIL((void) (int) arg(0).min(0).max(1.5));
+    (void) (int) arg(0).min(1).max(3).min(2).max(2);
+    arg base = arg(0).min(1);
+    (void) (int) base.max(3);
+    EXPECT_EXIT_FAIL((void) (int) base.max(1));
 }
 
 TEST(arg, one_of) {
@@ -560,10 +944,29 @@ TEST(arg, one_of) {
     (void) (std::string) arg(2).one_of({"string"});
     EXPECT_EXIT_FAIL((void) (std::string) arg(2).one_of({"other string"}));
 
+    (void) (int) arg(0).one_of({0, 1}).one_of({0, 2});
+    EXPECT_EXIT_FAIL((void) (int) arg(0).one_of({1, 2}).one_of({0, 2}));
+    EXPECT_EXIT_FAIL((void) (int) arg(0).one_of({0, 2}).one_of({1, 2}));
+    EXPECT_EXIT_FAIL((void) (int) arg(0).one_of({0}).max(-1));
+
+    vector<string> many;
+    for(int i = 0; i < 10000; ++i)
+        many.push_back("code" + to_string(i));
+    many.push_back("string");
+    (void) (std::string) arg(2).one_of(many);
+    many.pop_back();
+    EXPECT_EXIT_FAIL((void) (std::string) arg(2).one_of(many));
+
     // Type checking
     EXPECT_EXIT_FAIL((void) (int) arg(0).one_of({1.0}));
     EXPECT_EXIT_FAIL((void) (double) arg(1).one_of({"string"}));
     EXPECT_EXIT_FAIL((void) (std::string) arg(2).one_of({1}));
+
+    // Unsigned values aren't narrowed, and are compared with signed arguments by value
+    init_args({"./run_tests", "18446744073709551615", "-1"});
+    EXPECT_EQ((unsigned long long) arg(0).one_of({1ULL, 18446744073709551615ULL}), 18446744073709551615ULL);
+    EXPECT_EXIT_FAIL((void) (long long) arg(1).one_of({1ULL, 18446744073709551615ULL}));
+    EXPECT_EXIT_FAIL((void) (unsigned long long) arg(0).one_of({-1LL}));
 }
 
 bool dashed_values_inside = false;
@@ -684,12 +1087,31 @@ TEST(logger, assignement_arguments) {
     (void) (float) arg("--float");
     (void) (bool) arg("--bool");
 
-    vector<string> args = _::logger.get_assignment_arguments();
-    EXPECT_NE(find(args.begin(), args.end(), "-i"), args.end());
-    EXPECT_NE(find(args.begin(), args.end(), "--int"), args.end());
-    EXPECT_NE(find(args.begin(), args.end(), "-s"), args.end());
-    EXPECT_NE(find(args.begin(), args.end(), "--float"), args.end());
-    EXPECT_EQ(find(args.begin(), args.end(), "--bool"), args.end());
+    using kind = _option_table::kind;
+    _option_table options = _::logger().compile_options();
+    EXPECT_EQ(options.classify(1, "i"), kind::valued);
+    EXPECT_EQ(options.classify(2, "int"), kind::valued);
+    EXPECT_EQ(options.classify(1, "s"), kind::valued);
+    EXPECT_EQ(options.classify(2, "float"), kind::valued);
+    EXPECT_EQ(options.classify(2, "bool"), kind::flag);
+    EXPECT_EQ(options.classify(1, "x"), kind::unknown);
+    EXPECT_EQ(options.classify(2, "i"), kind::unknown);
+    EXPECT_EQ(options.classify(1, "int"), kind::unknown);
+    EXPECT_EQ(options.classify(3, "int"), kind::unknown);
+}
+
+TEST(logger, option_table) {
+    using kind = _option_table::kind;
+    _option_table options;
+    for(int i = 0; i < 1000; ++i)
+        options.add(2, "option" + to_string(i), i % 2 ? kind::flag : kind::valued);
+    options.add(2, "option1", kind::valued); // Declared both ways, takes a value
+
+    EXPECT_EQ(options.classify(2, "option0"), kind::valued);
+    EXPECT_EQ(options.classify(2, "option1"), kind::valued);
+    EXPECT_EQ(options.classify(2, "option3"), kind::flag);
+    EXPECT_EQ(options.classify(2, "option999"), kind::flag);
+    EXPECT_EQ(options.classify(2, "option1000"), kind::unknown);
 }
 
 TEST(logger, match_identifier) {
@@ -697,10 +1119,62 @@ TEST(logger, match_identifier) {
     (void) (int) arg({"-i", "--int"}, 0);
     (void) (long) arg({"-l", "--longer"}, 0);
 
-    EXPECT_EQ(_::logger.match_identifier(identifier({"-i"}, fire::optional<int>())), identifier({"-i", "--int"}, fire::optional<int>())); // The one declared in arg
-    EXPECT_EQ(_::logger.match_identifier(identifier({"--int"}, fire::optional<int>())), identifier({"-i", "--int"}, fire::optional<int>()));
+    EXPECT_EQ(_::logger().match_identifier(identifier({"-i"}, fire::optional<int>())), identifier({"-i", "--int"}, fire::optional<int>())); // The one declared in arg
+    EXPECT_EQ(_::logger().match_identifier(identifier({"--int"}, fire::optional<int>())), identifier({"-i", "--int"}, fire::optional<int>()));
+
+    EXPECT_EQ(_::logger().match_identifier(identifier({"--not-listed"}, fire::optional<int>())), fire::optional<identifier>());
+}
+
+TEST(logger, help_text) {
+    init_args({"./run_tests"});
+    (void) (int) arg({"-x", "x value"}, 5).bounds(0, 10);
+    (void) (int) arg({"-y"}, 1).min(-1).one_of({-1, 1}).one_of({1, 2});
+    (void) (string) arg({"--name", "name"}, "default name").one_of({"a", "default name"});
+
+    testing::internal::CaptureStderr();
+    print_help();
+    string help = testing::internal::GetCapturedStderr();
 
-    EXPECT_EQ(_::logger.match_identifier(identifier({"--not-listed"}, fire::optional<int>())), fire::optional<identifier>());
+    EXPECT_NE(help.find("x value [0 <= x <= 10] [default: 5]\n"), string::npos);
+    EXPECT_NE(help.find("[-1 <= y] [Possible values: (-1, 1)] [Possible values: (1, 2)] [default: 1]\n"), string::npos);
+    EXPECT_NE(help.find("name [Possible values: (a, default name)] [default: default name]\n"), string::npos);
+}
+
+TEST(logger, help_filter) {
+    init_args({"./run_tests", "3"});
+    (void) (int) arg({"-x", "--x-coordinate", "Horizontal position"}, 0);
+    (void) (int) arg({"-y", "--y-coordinate", "Vertical position"}, 0);
+    (void) (bool) arg({"-v", "--verbose"});
+    (void) (int) arg({0, "<count>", "Number of repetitions"});
+
+    auto help = [](_string_view filter) {
+        testing::internal::CaptureStderr();
+        _::logger().print_help(filter);
+        return testing::internal::GetCapturedStderr();
+    };
+
+    string all = help("");
+    EXPECT_LT(all.find("<count>"), all.find("-x|--x-coordinate"));
+    EXPECT_LT(all.find("-x|--x-coordinate"), all.find("-y|--y-coordinate"));
+    EXPECT_LT(all.find("-y|--y-coordinate"), all.find("-v|--verbose"));
+
+    string vertical = help("VERTICAL");
+    EXPECT_NE(vertical.find("-y|--y-coordinate"), string::npos);
+    EXPECT_EQ(vertical.find("-x|--x-coordinate"), string::npos);
+    EXPECT_EQ(vertical.find("Flags:"), string::npos);
+
+    string coordinates = help("coordinate");
+    EXPECT_NE(coordinates.find("-x|--x-coordinate"), string::npos);
+    EXPECT_NE(coordinates.find("-y|--y-coordinate"), string::npos);
+    EXPECT_EQ(coordinates.find("<count>"), string::npos);
+
+    EXPECT_NE(help("nothing like this").find("No arguments match"), string::npos);
+
+    // Generated text isn't searched
+    for(const char *generated: {"integer", "default", "<0>", "=", "|"})
+        EXPECT_NE(help(generated).find("No arguments match"), string::npos) << generated;
+    EXPECT_NE(help("--VERBOSE").find("-v|--verbose"), string::npos);
+    EXPECT_NE(help("<count>").find("Number of repetitions"), string::npos);
 }
 
 bool ambiguous_args_inside1 = false;
@@ -753,6 +1227,11 @@ TEST(post_call, error) {
     EXPECT_EXIT_FAIL(input_error("error"));
     input_assert(true, "error");
     EXPECT_EXIT_FAIL(input_assert(false, "error"));
+
+    bool built = false;
+    input_assert(true, [&]{ built = true; return string("error"); });
+    EXPECT_FALSE(built);
+    EXPECT_EXIT_FAIL(input_assert(false, []{ return string("error"); }));
 }
 
 TEST(post_call, helpful_name) {
@@ -777,6 +1256,18 @@ TEST(post_call, helpful_name) {
     EXPECT_EQ(helpful_name(0), "<0>");
 }
 
+TEST(post_call, free_parser_memory) {
+    init_args_strict({"./run_tests", "-v", "3"}, 2);
+    (void) (bool) arg({"-v", "--verbose"});
+    (void) (int) arg(0);
+    EXPECT_EQ(helpful_name("-v"), "-v");
+
+    free_parser_memory();
+    EXPECT_EQ(_::matcher().get_tokens().capacity(), 0u);
+    EXPECT_EXIT_FAIL((void) helpful_name("-v"));
+    EXPECT_EQ(raw_args.argc(), 3);
+}
+
 TEST(post_call, helpful_name_identifier) {
     fire::optional<int> empty;
 
@@ -792,3 +1283,314 @@ TEST(post_call, helpful_name_identifier) {
     (void) (int) arg(0);
     EXPECT_EQ(helpful_name(identifier({}, fire::optional<int>(0))), "<0>");
 }
+
+struct schema_options {
+    int x = 0;
+    double ratio = 0;
+    string name;
+    fire::optional<int> limit;
+    bool verbose = false;
+    vector<string> files;
+};
+
+fire::schema<schema_options> options_schema() {
+    fire::schema<schema_options> options("Schema test");
+    options.add(&schema_options::x, arg({"-x", "--x-coord"}).min(0))
+           .add(&schema_options::ratio, arg("--ratio", 0.5))
+           .add(&schema_options::name, arg("--name"))
+           .add(&schema_options::limit, arg("--limit"))
+           .add(&schema_options::verbose, arg("-v"))
+           .add(&schema_options::files, arg(variadic()));
+    return options;
+}
+
+schema_options parse_schema(const vector<const char *> &args) {
+    static vector<const char *> argv; // Matcher points into argv
+    argv = args;
+    return options_schema().parse((int) argv.size(), argv.data());
+}
+
+TEST(schema, parse) {
+    schema_options parsed = parse_schema({"./run_tests", "-x", "3", "--name", "abc", "-v", "a", "b"});
+    EXPECT_EQ(parsed.x, 3);
+    EXPECT_EQ(parsed.ratio, 0.5);
+    EXPECT_EQ(parsed.name, "abc");
+    EXPECT_FALSE(parsed.limit.has_value());
+    EXPECT_TRUE(parsed.verbose);
+    EXPECT_EQ(parsed.files, vector<string>({"a", "b"}));
+
+    parsed = parse_schema({"./run_tests", "--x-coord=1", "--ratio", "1.5", "--name=n", "--limit", "-2"});
+    EXPECT_EQ(parsed.x, 1);
+    EXPECT_EQ(parsed.ratio, 1.5);
+    EXPECT_EQ(parsed.limit.value(), -2);
+    EXPECT_FALSE(parsed.verbose);
+    EXPECT_TRUE(parsed.files.empty());
+}
+
+TEST(schema, errors) {
+    EXPECT_EXIT_FAIL(parse_schema({"./run_tests", "--name", "abc"}));
+    EXPECT_EXIT_FAIL(parse_schema({"./run_tests", "-x", "-1", "--name", "abc"}));
+    EXPECT_EXIT_FAIL(parse_schema({"./run_tests", "-x", "1", "--name", "abc", "--undeclared"}));
+    EXPECT_EXIT_SUCCESS(parse_schema({"./run_tests", "-h"}));
+}
+
+TEST(context, separate_threads) {
+    // Each thread parses its own command lines in its own context with a shared schema, results and errors must never mix
+    const int thread_count = 8, iterations = 300;
+    vector<int> mismatches(thread_count, 0);
+    vector<const void *> contexts(thread_count, nullptr);
+    const fire::schema<schema_options> schema = options_schema(); // Built in the main thread's context
+
+    vector<thread> threads;
+    for(int t = 0; t < thread_count; ++t)
+        threads.emplace_back([t, &mismatches, &contexts, &schema] {
+            fire::context ctx;
+            fire::context::scope active(ctx);
+            contexts[t] = &fire::_::current();
+
+            for(int i = 0; i < iterations; ++i) {
+                string x = to_string(t * iterations + i), name = "thread" + to_string(t);
+                vector<const char *> argv = {"./run_tests", "-x", x.c_str(), "--name", name.c_str(), name.c_str()};
+                if(t % 2 == 0)
+                    argv.push_back("-v");
+
+                schema_options parsed = schema.parse((int) argv.size(), argv.data());
+                bool matches = parsed.x == t * iterations + i && parsed.name == name && parsed.verbose == (t % 2 == 0) &&
+                               parsed.files == vector<string>({name}) && fire::raw_args.argc() == (int) argv.size() &&
+                               fire::raw_args.argv()[2] == x;
+                mismatches[t] += ! matches;
+            }
+        });
+    for(thread &th: threads)
+        th.join();
+
+    for(int t = 0; t < thread_count; ++t) {
+        EXPECT_EQ(mismatches[t], 0);
+        for(int other = 0; other < t; ++other)
+            EXPECT_NE(contexts[t], contexts[other]);
+    }
+}
+
+TEST(context, scope) {
+    fire::context &outer = fire::_::current();
+    {
+        fire::context inner;
+        fire::context::scope active(inner);
+        EXPECT_EQ(&fire::_::current(), &inner);
+
+        const char *argv[] = {"./run_tests", "-x=1"};
+        fire::_::matcher() = _matcher(2, argv, 1, false, false);
+        EXPECT_EQ((int) arg("-x"), 1);
+        fire::c_args copy = fire::raw_args;
+        EXPECT_EQ(copy.argc(), 2);
+    }
+    EXPECT_EQ(&fire::_::current(), &outer);
+
+    std::thread([&outer]{ EXPECT_NE(&fire::_::current(), &outer); }).join(); // Threads have their own default context
+}
+
+int program_body_runs = 0;
+int program_main(int x = arg({"-x", "--x-value"}), fire::optional<int> y = arg("-y"), bool flag = arg("-f"),
+                 vector<string> rest = arg(variadic())) {
+    ++program_body_runs;
+    return x + y.value_or(0) + flag + (int) rest.size();
+}
+
+TEST(program, run_and_parse) {
+    fire::program program = FIRE_PROGRAM(program_main, "Program test");
+    program_body_runs = 0;
+
+    // Values given as `-x 1` need the introspected declarations, which are reused for every command line
+    for(int i = 0; i < 100; ++i) {
+        string x = to_string(i);
+        vector<const char *> argv = {"./run_tests", "-x", x.c_str(), "-f", "a", "b"};
+        EXPECT_EQ(program.run((int) argv.size(), argv.data()), i + 3);
+    }
+    vector<const char *> argv = {"./run_tests", "--x-value", "2", "-y", "3"};
+    EXPECT_EQ(program.run((int) argv.size(), argv.data()), 5);
+    EXPECT_EQ(program_body_runs, 101);
+
+    EXPECT_TRUE(program.parse((int) argv.size(), argv.data()));
+    EXPECT_EQ(program_body_runs, 101); // Body doesn't run
+
+    program.set_error_policy(error_policy::status);
+    testing::internal::CaptureStderr();
+    vector<const char *> invalid = {"./run_tests", "-y", "3"};
+    EXPECT_FALSE(program.parse((int) invalid.size(), invalid.data()));
+    EXPECT_EQ(program.run((int) invalid.size(), invalid.data()), _failure_code);
+    vector<const char *> help = {"./run_tests", "-h"};
+    EXPECT_EQ(program.run((int) help.size(), help.data()), 0);
+    string printed = testing::internal::GetCapturedStderr();
+    EXPECT_NE(printed.find("Error: required argument --x-value not provided"), string::npos);
+    EXPECT_NE(printed.find("Program test"), string::npos);
+    EXPECT_EQ(program_body_runs, 101);
+}
+
+TEST(program, run_batch) {
+    fire::program program = FIRE_PROGRAM(program_main);
+    program.set_error_policy(error_policy::status);
+    program_body_runs = 0;
+
+    istringstream lines("-x 1 a 'b c'\n\n  # comment\n--x-value=2 -y 3\n-y 3\n-x 'unterminated\n-x 0 -f\n");
+    testing::internal::CaptureStderr();
+    EXPECT_EQ(program.run_batch(lines, "./run_tests"), _failure_code);
+    string printed = testing::internal::GetCapturedStderr();
+    EXPECT_EQ(program_body_runs, 3);
+
+    // Each failure is reported right after the line's own error message
+    size_t quote_error = printed.find("Error: unterminated quote");
+    EXPECT_LT(printed.find("Line 1 exited with code 3\n"), printed.find("Line 4 exited with code 5\n"));
+    EXPECT_LT(printed.find("Line 5 exited with code " + to_string(_failure_code)), quote_error);
+    EXPECT_LT(quote_error, printed.find("Line 6 exited with code " + to_string(_failure_code)));
+    EXPECT_LT(quote_error, printed.find("Line 7 exited with code 1\n"));
+    EXPECT_EQ(printed.find("Line 2 "), string::npos);
+
+    istringstream succeeding("-x 0\n\n-x 1 -y -1\n");
+    EXPECT_EQ(program.run_batch(succeeding, "./run_tests"), 0);
+}
+
+int raw_args_walk_main() {
+    int count = 0;
+    while(fire::raw_args.argv()[count] != nullptr)
+        ++count;
+    return count == fire::raw_args.argc() ? 0 : 1;
+}
+
+TEST(program, run_batch_argv_is_null_terminated) {
+    fire::program program = FIRE_PROGRAM_ALLOW_UNUSED(raw_args_walk_main);
+    istringstream lines("a\na b c\n-x 1 2\n");
+    EXPECT_EQ(program.run_batch(lines, "./run_tests"), 0);
+}
+
+int first_subcommand_calls = 0, second_subcommand_calls = 0;
+int first_subcommand(int x = arg("-x")) { ++first_subcommand_calls; return x; }
+int second_subcommand(string text = arg(0), bool flag = arg("-f")) { ++second_subcommand_calls; return (int) text.size() + flag; }
+
+TEST(subcommands, dispatch) {
+    // Only the selected subcommand is introspected: a conversion in the other one would run its body
+    static const fire::subcommand table[] = {
+        FIRE_SUBCOMMAND("first", first_subcommand, "First subcommand"),
+        FIRE_SUBCOMMAND("second", second_subcommand)
+    };
+    auto run = [](vector<const char *> argv) { return _subcommands_main(begin(table), end(table), (int) argv.size(), argv.data()); };
+
+    EXPECT_EQ(run({"./run_tests", "first", "-x", "7"}), 7);
+    EXPECT_EQ(run({"./run_tests", "second", "abc", "-f"}), 4);
+    EXPECT_EQ(first_subcommand_calls, 1);
+    EXPECT_EQ(second_subcommand_calls, 1);
+    EXPECT_EQ(_::matcher().get_executable(), "./run_tests second");
+
+    EXPECT_EXIT_FAIL(run({"./run_tests"}));
+    EXPECT_EXIT_FAIL(run({"./run_tests", "third"}));
+    EXPECT_EXIT_FAIL(run({"./run_tests", "first", "-x", "7", "-f"}));
+    EXPECT_EXIT_SUCCESS(run({"./run_tests", "--help"}));
+    EXPECT_EXIT_SUCCESS(run({"./run_tests", "second", "--help"}));
+    EXPECT_EQ(second_subcommand_calls, 1);
+
+    string help = _subcommands_help(begin(table), end(table), "./run_tests", "FIRST");
+    EXPECT_NE(help.find("  first  First subcommand\n"), string::npos);
+    EXPECT_EQ(help.find("second"), string::npos);
+}
+
+TEST(subcommands, argv_is_null_terminated) {
+    static const fire::subcommand table[] = {
+        {"raw", "", [](int argc, const char **argv) { return argv[argc] == nullptr ? argc : -1; }}
+    };
+    const char *argv[] = {"./run_tests", "raw", "a", "b", nullptr};
+    EXPECT_EQ(_subcommands_main(begin(table), end(table), 4, argv), 3);
+}
+
+int head_calls = 0, tail_calls = 0;
+int head_tool(int lines = arg({"-n", "--lines"}, 10), fire::optional<string> file = arg(0)) {
+    ++head_calls;
+    return lines + (int) file.value_or("").size();
+}
+int tail_tool(bool follow = arg({"-f", "--follow"}), int bytes = arg({"-c", "--bytes"}, 0)) { ++tail_calls; return 100 * follow + bytes; }
+
+TEST(multicall, dispatch_on_program_name) {
+    static const fire::subcommand tools[] = {
+        FIRE_SUBCOMMAND("head", head_tool, "Print the first lines"),
+        FIRE_SUBCOMMAND("tail", tail_tool, "Print the last lines")
+    };
+    auto run = [](vector<const char *> argv) { return _multicall_main(begin(tools), end(tools), (int) argv.size(), argv.data()); };
+
+    EXPECT_EQ(_program_name("/usr/local/bin/head"), "head");
+    EXPECT_EQ(_program_name("C:\\tools\\tail.exe"), "tail");
+    EXPECT_EQ(_program_name("head"), "head");
+#ifdef _WIN32
+    EXPECT_EQ(_program_name("C:\\TOOLS\\TAIL.EXE"), "TAIL");
+    EXPECT_EQ(_program_name("C:\\tools\\tail.Exe"), "tail");
+#else
+    EXPECT_EQ(_program_name("/usr/bin/TAIL.EXE"), "TAIL.EXE");
+#endif
+
+    // Each personality knows only its own arguments
+    EXPECT_EQ(run({"/usr/bin/head", "-n", "3", "file"}), 7);
+    EXPECT_EQ(_::matcher().get_executable(), "/usr/bin/head");
+    string head_help = _::logger().help_text();
+    EXPECT_NE(head_help.find("--lines"), string::npos);
+    EXPECT_EQ(head_help.find("--follow"), string::npos);
+    EXPECT_EXIT_FAIL(run({"/usr/bin/head", "--follow"}));
+
+    EXPECT_EQ(run({"tail", "-f", "-c", "5"}), 105);
+    string tail_help = _::logger().help_text();
+    EXPECT_NE(tail_help.find("--follow"), string::npos);
+    EXPECT_EQ(tail_help.find("--lines"), string::npos);
+    EXPECT_EXIT_FAIL(run({"tail", "-n", "3"}));
+
+    // Under the binary's own name, the first argument selects the tool
+    EXPECT_EQ(run({"./multicall", "head", "-n", "1"}), 1);
+    EXPECT_EXIT_FAIL(run({"./multicall", "cat"}));
+    EXPECT_EQ(head_calls, 2);
+    EXPECT_EQ(tail_calls, 1);
+}
+
+struct destructor_counter {
+    int &count;
+    ~destructor_counter() { ++count; }
+};
+
+int destroyed_in_body = 0;
+int checked_main(int x = arg({"-x", "--x-value"}).bounds(0, 10)) {
+    destructor_counter counter{destroyed_in_body};
+    input_assert(x != 5, "x must not be 5");
+    return x;
+}
+
+TEST(program, error_policy) {
+    fire::program program = FIRE_PROGRAM(checked_main);
+    vector<const char *> out_of_bounds = {"./run_tests", "-x", "11"};
+    vector<const char *> in_body = {"./run_tests", "-x", "5"};
+    vector<const char *> help = {"./run_tests", "--help"};
+
+    // Status: errors go to the reporter and end the call, destroying the body's objects
+    vector<fire::error> reported;
+    program.get_context().reporter = [&](const fire::error &e) { reported.push_back(e); };
+    program.set_error_policy(error_policy::status);
+    EXPECT_EQ(program.run((int) out_of_bounds.size(), out_of_bounds.data()), _failure_code);
+    EXPECT_EQ(program.run((int) in_body.size(), in_body.data()), _failure_code);
+    EXPECT_EQ(destroyed_in_body, 1);
+    EXPECT_FALSE(program.parse((int) help.size(), help.data()));
+    EXPECT_TRUE(program.get_context().last_error.value().k == fire::error::kind::help);
+
+    ASSERT_EQ(reported.size(), 3u);
+    EXPECT_TRUE(reported[0].k == fire::error::kind::input);
+    EXPECT_EQ(reported[0].argument, "--x-value");
+    EXPECT_EQ(reported[0].message, "argument -x value 11 must be at most 10");
+    EXPECT_EQ(reported[1].argument, "");
+    EXPECT_EQ(reported[1].message, "x must not be 5");
+    EXPECT_EQ(reported[2].code, 0);
+    EXPECT_NE(reported[2].message.find("-x|--x-value"), string::npos);
+
+    // Exception: errors are thrown without being reported
+    program.set_error_policy(error_policy::exception);
+    try {
+        program.run((int) out_of_bounds.size(), out_of_bounds.data());
+        ADD_FAILURE() << "fire::error not thrown";
+    } catch(const fire::error &e) {
+        EXPECT_EQ(e.code, _failure_code);
+        EXPECT_EQ(e.argument, "--x-value");
+        EXPECT_STREQ(e.what(), reported[0].message.c_str());
+    }
+    EXPECT_EQ(reported.size(), 3u);
+}